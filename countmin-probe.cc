@@ -0,0 +1,96 @@
+#include "countmin-probe.h"
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("CountMinProbe");
+  NS_OBJECT_ENSURE_REGISTERED(CountMinProbe);
+
+  TypeId
+  CountMinProbe::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::CountMinProbe")
+      .SetParent<HeavyHitterProbe> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<CountMinProbe> ()
+      .AddAttribute("NumOfRows",
+		    "The num of counter rows, one hash each",
+		    UintegerValue(4),
+		    MakeUintegerAccessor(&CountMinProbe::m_numRows),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("NumOfCounters",
+		    "The num of counters per row",
+		    UintegerValue(1024),
+		    MakeUintegerAccessor(&CountMinProbe::m_numCounters),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("CounterBits",
+		    "The bits of a counter, counters are packed to take NumOfRows * NumOfCounters * CounterBits bits",
+		    UintegerValue(32),
+		    MakeUintegerAccessor(&CountMinProbe::m_counterBits),
+		    MakeUintegerChecker<uint32_t>(1, PackedCounterArray<uint64_t>::MAX_BITS));
+
+    return tid;
+  }
+
+  CountMinProbe::CountMinProbe ()
+  {
+  }
+
+  CountMinProbe::~CountMinProbe ()
+  {
+  }
+
+  void
+  CountMinProbe::NotifyConstructionCompleted (void)
+  {
+    HeavyHitterProbe::NotifyConstructionCompleted ();
+    m_counters.Assign (m_numRows * m_numCounters, m_counterBits);
+  }
+
+  void
+  CountMinProbe::ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash)
+  {
+    uint32_t byteCnt = ipHeader.GetPayloadSize();
+
+    //1. Update real flow stats;
+    UpdateRealFlowStats (flow, hash, byteCnt);
+
+    //2. Update the sketch, the estimate is the minimum seen on the way;
+    uint64_t estimate = ~(uint64_t)0;
+    for (uint32_t i = 0; i < m_numRows; ++i)
+      {
+	uint64_t counter = m_counters.Add (i * m_numCounters + FlowHashIndex (hash, i, m_numCounters), byteCnt);
+	estimate = std::min (estimate, counter);
+      }
+    Offer (flow, hash, estimate);
+  }
+
+  uint64_t
+  CountMinProbe::Estimate (const FlowField& flow, uint64_t hash) const
+  {
+    uint64_t estimate = ~(uint64_t)0;
+    for (uint32_t i = 0; i < m_numRows; ++i)
+      {
+	estimate = std::min (estimate, m_counters.Get (i * m_numCounters + FlowHashIndex (hash, i, m_numCounters)));
+      }
+    return estimate;
+  }
+
+  uint64_t
+  CountMinProbe::GetMemoryBytes () const
+  {
+    return m_counters.GetMemoryBytes();
+  }
+
+  void
+  CountMinProbe::ClearSketch ()
+  {
+    m_counters.Clear ();
+  }
+
+}
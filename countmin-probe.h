@@ -0,0 +1,40 @@
+#ifndef COUNTMIN_PROBE_H
+#define COUNTMIN_PROBE_H
+
+#include "heavy-hitter-probe.h"
+#include "neo-counter.h"
+
+namespace ns3
+{
+
+  ///Count-Min sketch of flow bytes: NumOfRows rows of NumOfCounters counters
+  ///of CounterBits bits, a flow adds to one counter per row and is estimated
+  ///by the smallest. Counters saturate instead of wrapping.
+  class CountMinProbe : public HeavyHitterProbe
+  {
+  public:
+    CountMinProbe ();
+    virtual ~CountMinProbe ();
+    static TypeId GetTypeId (void);
+
+  public:
+    void ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash);
+
+    uint64_t Estimate (const FlowField& flow, uint64_t hash) const;
+    uint64_t GetMemoryBytes () const;
+
+  protected:
+    virtual void NotifyConstructionCompleted (void);
+    virtual void ClearSketch ();
+
+  private:
+    uint32_t m_numRows;     //Attribute
+    uint32_t m_numCounters; //Attribute
+    uint32_t m_counterBits; //Attribute
+
+    PackedCounterArray<uint64_t> m_counters; //row major
+  };
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include "countsketch-probe.h"
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("CountSketchProbe");
+  NS_OBJECT_ENSURE_REGISTERED(CountSketchProbe);
+
+  TypeId
+  CountSketchProbe::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::CountSketchProbe")
+      .SetParent<HeavyHitterProbe> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<CountSketchProbe> ()
+      .AddAttribute("NumOfRows",
+		    "The num of counter rows, one hash and sign each",
+		    UintegerValue(5),
+		    MakeUintegerAccessor(&CountSketchProbe::m_numRows),
+		    MakeUintegerChecker<uint32_t>(1, CountSketchProbe::MAX_ROWS))
+      .AddAttribute("NumOfCounters",
+		    "The num of counters per row",
+		    UintegerValue(1024),
+		    MakeUintegerAccessor(&CountSketchProbe::m_numCounters),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("CounterBits",
+		    "The bits of a signed counter, counters are packed to take NumOfRows * NumOfCounters * CounterBits bits",
+		    UintegerValue(32),
+		    MakeUintegerAccessor(&CountSketchProbe::m_counterBits),
+		    MakeUintegerChecker<uint32_t>(2, PackedCounterArray<int64_t>::MAX_BITS));
+
+    return tid;
+  }
+
+  CountSketchProbe::CountSketchProbe ()
+  {
+  }
+
+  CountSketchProbe::~CountSketchProbe ()
+  {
+  }
+
+  void
+  CountSketchProbe::NotifyConstructionCompleted (void)
+  {
+    HeavyHitterProbe::NotifyConstructionCompleted ();
+    m_counters.Assign (m_numRows * m_numCounters, m_counterBits);
+  }
+
+  void
+  CountSketchProbe::ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash)
+  {
+    int32_t byteCnt = ipHeader.GetPayloadSize();
+
+    //1. Update real flow stats;
+    UpdateRealFlowStats (flow, hash, byteCnt);
+
+    //2. Update the sketch;
+    for (uint32_t i = 0; i < m_numRows; ++i)
+      {
+	m_counters.Add (i * m_numCounters + FlowHashIndex (hash, i, m_numCounters), FlowHashSign (hash, i) * byteCnt);
+      }
+    Offer (flow, hash, Estimate (flow, hash));
+  }
+
+  uint64_t
+  CountSketchProbe::Estimate (const FlowField& flow, uint64_t hash) const
+  {
+    int64_t rows[MAX_ROWS];
+    for (uint32_t i = 0; i < m_numRows; ++i)
+      {
+	rows[i] = FlowHashSign (hash, i) * m_counters.Get (i * m_numCounters + FlowHashIndex (hash, i, m_numCounters));
+      }
+
+    //Median, the mean of the two middle rows for an even num of rows
+    uint32_t mid = m_numRows / 2;
+    std::nth_element (rows, rows + mid, rows + m_numRows);
+    int64_t median = rows[mid];
+    if (m_numRows % 2 == 0)
+      {
+	median = (median + *std::max_element (rows, rows + mid)) / 2;
+      }
+    return median > 0 ? median : 0;
+  }
+
+  uint64_t
+  CountSketchProbe::GetMemoryBytes () const
+  {
+    return m_counters.GetMemoryBytes();
+  }
+
+  void
+  CountSketchProbe::ClearSketch ()
+  {
+    m_counters.Clear ();
+  }
+
+}
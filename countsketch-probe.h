@@ -0,0 +1,43 @@
+#ifndef COUNTSKETCH_PROBE_H
+#define COUNTSKETCH_PROBE_H
+
+#include "heavy-hitter-probe.h"
+#include "neo-counter.h"
+
+namespace ns3
+{
+
+  ///Count Sketch of flow bytes: NumOfRows rows of NumOfCounters signed
+  ///counters, a flow adds +bytes or -bytes to one counter per row and is
+  ///estimated by the median of the signed counters. Counters have CounterBits
+  ///bits and saturate at either end instead of wrapping.
+  class CountSketchProbe : public HeavyHitterProbe
+  {
+  public:
+    CountSketchProbe ();
+    virtual ~CountSketchProbe ();
+    static TypeId GetTypeId (void);
+
+  public:
+    void ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash);
+
+    uint64_t Estimate (const FlowField& flow, uint64_t hash) const;
+    uint64_t GetMemoryBytes () const;
+
+    static const uint32_t MAX_ROWS = 16;
+
+  protected:
+    virtual void NotifyConstructionCompleted (void);
+    virtual void ClearSketch ();
+
+  private:
+    uint32_t m_numRows;     //Attribute
+    uint32_t m_numCounters; //Attribute
+    uint32_t m_counterBits; //Attribute
+
+    PackedCounterArray<int64_t> m_counters; //row major
+  };
+
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*Runs the NeoBenchmark suites and writes their results, so that runs of
+ *different commits can be compared:
+ *
+ *  neo-benchmark --suites=probe,hash --format=Json --file=bench.json
+ *
+ *Suites are probe, forward, hash, decode, setup and topology, all by
+ *default. Sizes and probes are NeoBenchmark attributes, set them on the
+ *command line too, e.g. --ns3::NeoBenchmark::NumOfPackets=1000000, and the
+ *probe sizes with --ns3::FlowRadarProbe::... . Built as a program of the
+ *module like any ns-3 example (or copied to scratch/).
+ */
+#include "ns3/core-module.h"
+#include "ns3/neo-benchmark.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace ns3;
+
+int
+main (int argc, char* argv[])
+{
+  std::string suites   = "probe,forward,hash,decode,setup,topology";
+  std::string format   = "Csv";
+  std::string fileName = "neo-benchmark.csv";
+
+  CommandLine cmd;
+  cmd.AddValue ("suites", "Comma separated suites: probe, forward, hash, decode, setup, topology", suites);
+  cmd.AddValue ("format", "Csv or Json", format);
+  cmd.AddValue ("file",   "The results file, empty for the standard output", fileName);
+  cmd.Parse (argc, argv);
+
+  Ptr<NeoBenchmark> benchmark = CreateObject<NeoBenchmark> ();
+  if (!benchmark->SetAttributeFailSafe ("Format", StringValue (format)))
+    {
+      std::cerr << "Unknown format " << format << std::endl;
+      return 2;
+    }
+  benchmark->SetAttribute ("FileName", StringValue (fileName));
+
+  std::istringstream names (suites);
+  std::string        name;
+  while (std::getline (names, name, ','))
+    {
+      if      (name == "probe")    benchmark->RunProbes ();
+      else if (name == "forward")  benchmark->RunForward ();
+      else if (name == "hash")     benchmark->RunHashes ();
+      else if (name == "decode")   benchmark->RunDecoder ();
+      else if (name == "setup")    benchmark->RunFlowSetup ();
+      else if (name == "topology") benchmark->RunTopologySetup ();
+      else if (!name.empty ())
+	{
+	  std::cerr << "Unknown suite " << name << std::endl;
+	  return 2;
+	}
+    }
+  benchmark->Write ();
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,45 @@
+/*Converts a binary flow stats file of NeoStatsWriter to its text format:
+ *
+ *  neo-stats-convert neo-flow-stats.bin [neo-flow-stats.txt]
+ *
+ *The text goes to the standard output without a second file name. Only
+ *NeoStatsReader is needed, not the simulator, e.g.
+ *
+ *  g++ -O2 -I. examples/neo-stats-convert.cc neo-stats-reader.cc -o neo-stats-convert
+ */
+#include "neo-stats-reader.h"
+
+#include <fstream>
+#include <iostream>
+
+int
+main (int argc, char* argv[])
+{
+  if (argc < 2 || argc > 3)
+    {
+      std::cerr << "Usage: " << argv[0] << " <binary stats file> [text file]" << std::endl;
+      return 2;
+    }
+
+  ns3::NeoStatsReader reader;
+  if (!reader.Open (argv[1]))
+    {
+      std::cerr << argv[1] << " is not a valid flow stats file" << std::endl;
+      return 1;
+    }
+
+  if (argc == 2)
+    {
+      reader.WriteText (std::cout);
+      return std::cout ? 0 : 1;
+    }
+
+  std::ofstream file (argv[2]);
+  if (!file)
+    {
+      std::cerr << "Cannot open " << argv[2] << std::endl;
+      return 1;
+    }
+  reader.WriteText (file);
+  return file ? 0 : 1;
+}
@@ -1,16 +1,28 @@
 #include "fattree-network.h"
+#include "fattree-routing.h"
+#include "neo-probe.h"
 
+#include <algorithm>
 #include <string>
 
 #include "ns3/log.h"
 #include "ns3/integer.h"
 #include "ns3/boolean.h"
+#include "ns3/enum.h"
+#include "ns3/system-wall-clock-ms.h"
 
 #include "ns3/point-to-point-helper.h"
 #include "ns3/internet-stack-helper.h"
 #include "ns3/ipv4-address-helper.h"
 #include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/ipv4-list-routing.h"
 #include "ns3/trace-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/net-device.h"
+
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
 
 namespace ns3
 {
@@ -25,21 +37,43 @@ namespace ns3
       .SetParent<Object>()
       .SetGroupName("NeoFlowMonitor")
       .AddConstructor<FatTreeNetwork>()
+      .AddAttribute("FatTreeK",
+		    "k of a k-ary fat-tree (even, 4 to 64), 0 for the two tier layout",
+		    IntegerValue(0),
+		    MakeIntegerAccessor(&FatTreeNetwork::m_fatTreeK),
+		    internal::MakeIntegerChecker(0, 64, "int16_t"))
       .AddAttribute("NumOfHostPerPod",
-		    "The num of hosts node in each pod",
+		    "The num of hosts node in each pod, two tier layout only",
 		    IntegerValue(20),
 		    MakeIntegerAccessor(&FatTreeNetwork::m_numHostPerPod),
-		    internal::MakeIntegerChecker(2, 20, "int16_t"))
+		    MakeIntegerChecker<int16_t>(2))
       .AddAttribute("NumOfPod",
-		    "The num of pod",
+		    "The num of pod, two tier layout only",
 		    IntegerValue(8),
 		    MakeIntegerAccessor(&FatTreeNetwork::m_numPod),
-		    internal::MakeIntegerChecker(2, 8, "int16_t"))
+		    MakeIntegerChecker<int16_t>(2))
       .AddAttribute("NumOfCore",
-		    "The num of core swtches",
+		    "The num of core swtches, two tier layout only",
 		    IntegerValue(1),
 		    MakeIntegerAccessor(&FatTreeNetwork::m_numCore),
-		    internal::MakeIntegerChecker(1, 1, "int16_t"))
+		    MakeIntegerChecker<int16_t>(1))
+      .AddAttribute("NumOfAddrPerHost",
+		    "The num of addresses of each host, all in the subnet of its link",
+		    IntegerValue(1),
+		    MakeIntegerAccessor(&FatTreeNetwork::m_numAddrPerHost),
+		    MakeIntegerChecker<int16_t>(1, FatTreeNetwork::MAX_ADDR_PER_HOST))
+      .AddAttribute("Routing",
+		    "Global routing, or fat-tree routing computed from the topology",
+		    EnumValue(FatTreeNetwork::GLOBAL_ROUTING),
+		    MakeEnumAccessor(&FatTreeNetwork::m_routingMode),
+		    MakeEnumChecker(FatTreeNetwork::GLOBAL_ROUTING,  "Global",
+				    FatTreeNetwork::FATTREE_ROUTING, "FatTree"))
+      .AddAttribute("Ecmp",
+		    "Set true to spread flows over all equal cost paths by their hash, "
+		    "fat-tree routing only: global routing keeps one path",
+		    BooleanValue(true),
+		    MakeBooleanAccessor(&FatTreeNetwork::m_ecmpPredicate),
+		    MakeBooleanChecker())
       .AddAttribute("PrintRoutingTable",
 		    "Set true to turn on routing table",
 		    BooleanValue(false),
@@ -61,13 +95,47 @@ namespace ns3
   void 
   FatTreeNetwork::Initialize()
   {
+    if(m_fatTreeK > 0)
+      {
+	NS_ABORT_MSG_IF(m_fatTreeK < 4 || m_fatTreeK % 2, "FatTreeK must be even and at least 4");
+	int16_t half    = m_fatTreeK / 2;
+	m_numPod        = m_fatTreeK;
+	m_numEdgePerPod = half;
+	m_numAggPerPod  = half;
+	m_numHostPerPod = half * half;
+	m_numCore       = half * half;
+      }
+    else
+      {
+	m_numEdgePerPod = 1;
+	m_numAggPerPod  = 0;
+      }
+
     m_podHostNodes.resize(m_numPod);
 
+    SystemWallClockMs clock;
+
+    clock.Start();
     SetupNodes();
+    NS_LOG_INFO("Setup nodes : " << clock.End() << "ms");
 
+    //Fat-tree routes are added while the links are set up
+    clock.Start();
+    if(m_routingMode == FATTREE_ROUTING) SetupFatTreeRouting();
     SetupLinks();
+    m_topology = Create<NeoTopologyIndex>(m_podHostNodes, m_numAddrPerHost);
+    NS_LOG_INFO("Setup links : " << clock.End() << "ms");
 
-    SetupGlobalRoutingTable();
+    clock.Start();
+    if(m_routingMode == GLOBAL_ROUTING) SetupGlobalRoutingTable();
+    NS_LOG_INFO("Setup routing : " << clock.End() << "ms");
+
+    /*Output Routing Table Test*/
+    if(m_printRoutingTablePredicate)
+      {
+	Ptr<OutputStreamWrapper> os = Create<OutputStreamWrapper>(&std::cout);
+	Ipv4GlobalRoutingHelper::PrintRoutingTableAllAt(Seconds(0.), os);
+      }
   }
 
   void
@@ -77,34 +145,73 @@ namespace ns3
     
     NS_LOG_DEBUG("Pods : " << m_numPod);
     NS_LOG_DEBUG("Hosts per Pod : " << m_numHostPerPod);
+    NS_LOG_DEBUG("Edge per Pod : " << m_numEdgePerPod);
+    NS_LOG_DEBUG("Aggregation per Pod : " << m_numAggPerPod);
     NS_LOG_DEBUG("Core : " << m_numCore);
      //Create nodes in each sub network;
+    //A pod's hosts and switches share one logical process,
+    //so only the links to the core switches cross processes.
     InternetStackHelper internetStack;
 
     for(int iPod = 0; iPod < m_numPod; ++iPod) 
       {
-	m_podHostNodes[iPod].Create(m_numHostPerPod);
+	m_podHostNodes[iPod].Create(m_numHostPerPod, GetPodSystemId(iPod));
 	internetStack.Install(m_podHostNodes[iPod]);
       }
 
     //Create edge switches' node
-    m_podSwtchNodes.Create(m_numPod);
+    for(int iPod = 0; iPod < m_numPod; ++iPod)
+      {
+	m_podSwtchNodes.Create(m_numEdgePerPod, GetPodSystemId(iPod));
+      }
     internetStack.Install(m_podSwtchNodes);
 
+    //Create aggregation switches' node
+    for(int iPod = 0; iPod < m_numPod && m_numAggPerPod > 0; ++iPod)
+      {
+	m_aggSwtchNodes.Create(m_numAggPerPod, GetPodSystemId(iPod));
+      }
+    internetStack.Install(m_aggSwtchNodes);
+
     //Create core switches' node
-    m_coreSwtchNodes.Create(m_numCore);
+    m_coreSwtchNodes.Create(m_numCore, GetCoreSystemId());
     internetStack.Install(m_coreSwtchNodes);
 
+    const NodeContainer*   swtchNodes[3] = {&m_podSwtchNodes, &m_aggSwtchNodes, &m_coreSwtchNodes};
+    std::vector<uint32_t>* swtchIds[3]   = {&m_edgeIds, &m_aggIds, &m_coreIds};
+    for(uint32_t iT = 0; iT < 3; ++iT)
+      {
+	swtchIds[iT]->clear();
+	for(NodeContainer::Iterator it = swtchNodes[iT]->Begin(); it != swtchNodes[iT]->End(); ++it)
+	  {
+	    swtchIds[iT]->push_back((*it)->GetId());
+	  }
+      }
   }
 
   void
   FatTreeNetwork::SetupLinks()
   {
     NS_LOG_DEBUG("===Setup p2p links===");
-    
+
+    if(m_fatTreeK > 0) SetupKAryLinks();
+    else               SetupTwoTierLinks();
+
+    if(m_asciiTracePredicate)
+      {
+	AsciiTraceHelper ascii;
+	PointToPointHelper p2p;
+	p2p.EnableAsciiAll(ascii.CreateFileStream("neo-flow.tr"));
+      }   
+  }
+
+  void
+  FatTreeNetwork::SetupTwoTierLinks()
+  {
     PointToPointHelper p2p;
     Ipv4AddressHelper  ipv4Addr;
-    ipv4Addr.SetBase("10.0.0.0", "255.255.255.0");
+    Ipv4Mask           hostMask ("255.255.255.0");
+    ipv4Addr.SetBase("10.0.0.0", hostMask);
 
     for(int iPod = 0; iPod < m_numPod; ++iPod)
       {
@@ -113,44 +220,302 @@ namespace ns3
 	Ptr<Node>           iPodEdgeSwtchNode = m_podSwtchNodes.Get(iPod);
 
 	//Hosts to Edge swtch
+	std::vector<Ipv4Address> hostAddrs;
 	for(int iH = 0; iH < m_numHostPerPod; ++iH)
 	  {
 	    Ptr<Node> iHostNode = iPodHostNodes.Get(iH);
 	    NetDeviceContainer dHdSEdge = p2p.Install(NodeContainer(iHostNode, iPodEdgeSwtchNode));    
-	    ipv4Addr.Assign(dHdSEdge); ipv4Addr.NewNetwork();
+	    Ipv4InterfaceContainer iHdSEdge = ipv4Addr.Assign(dHdSEdge); ipv4Addr.NewNetwork();
+	    AddHostAddresses(dHdSEdge.Get(0), iHdSEdge.GetAddress(0), hostMask);
+
+	    hostAddrs.push_back(iHdSEdge.GetAddress(0));
+	    AddUpInterface(iHostNode, iHdSEdge.Get(0).second);
+	    AddDownRoute(iPodEdgeSwtchNode, iHdSEdge.GetAddress(0), hostMask, iHdSEdge.Get(1).second);
 	  }
 
-	//Edge swtch to Core swtch
-	NetDeviceContainer dSEdgeSCore = p2p.Install(NodeContainer(iPodEdgeSwtchNode, m_coreSwtchNodes.Get(0)));
-	ipv4Addr.Assign(dSEdgeSCore); ipv4Addr.NewNetwork();
+	//Edge swtch to every Core swtch
+	for(int iC = 0; iC < m_numCore; ++iC)
+	  {
+	    Ptr<Node> iCoreSwtchNode = m_coreSwtchNodes.Get(iC);
+	    NetDeviceContainer dSEdgeSCore = p2p.Install(NodeContainer(iPodEdgeSwtchNode, iCoreSwtchNode));
+	    Ipv4InterfaceContainer iSEdgeSCore = ipv4Addr.Assign(dSEdgeSCore); ipv4Addr.NewNetwork();
+
+	    AddUpInterface(iPodEdgeSwtchNode, iSEdgeSCore.Get(0).second);
+	    for(uint32_t iH = 0; iH < hostAddrs.size(); ++iH)
+	      {
+		AddDownRoute(iCoreSwtchNode, hostAddrs[iH], hostMask, iSEdgeSCore.Get(1).second);
+	      }
+	  }
       }
+  }
 
-    if(m_asciiTracePredicate)
+  /*k-ary fat-tree addresses are computed from the position instead of drawn
+   *from an Ipv4AddressHelper, which checks every new address against all the
+   *allocated ones:
+   *  host  - edge e : 10.pod.e.(8h+1)     - 10.pod.e.(8h+2)     /29
+   *                   extra host addresses 10.pod.e.(8h+3) to 10.pod.e.(8h+6)
+   *  edge e - agg a : 10.pod.(128+e).(4a+1) - 10.pod.(128+e).(4a+2) /30
+   *  agg a - core j : 10.pod.(192+a).(4j+1) - 10.pod.(192+a).(4j+2) /30
+   *where core j of aggregation a is core switch a * k/2 + j.
+   */
+  void
+  FatTreeNetwork::SetupKAryLinks()
+  {
+    PointToPointHelper p2p;
+    Ipv4Mask           hostMask ("255.255.255.248");
+    Ipv4Mask           linkMask ("255.255.255.252");
+    Ipv4Mask           edgeMask ("255.255.255.0");
+    Ipv4Mask           podMask  ("255.255.0.0");
+    int16_t            half = m_fatTreeK / 2;
+
+    for(int iPod = 0; iPod < m_numPod; ++iPod)
       {
-	AsciiTraceHelper ascii;
-	p2p.EnableAsciiAll(ascii.CreateFileStream("neo-flow.tr"));
-      }   
+	NS_LOG_DEBUG("Links in Pod " << iPod);
+	uint32_t podBase = (10 << 24) | (iPod << 16);
+
+	for(int iE = 0; iE < half; ++iE)
+	  {
+	    Ptr<Node> iEdgeSwtchNode = m_podSwtchNodes.Get(iPod * half + iE);
+
+	    //Hosts to Edge swtch
+	    for(int iH = 0; iH < half; ++iH)
+	      {
+		int32_t   iHst = iE * half + iH;
+		uint32_t  base = podBase | (iE << 8) | (8 * iH);
+		Ptr<Node> iHostNode = m_podHostNodes[iPod].Get(iHst);
+		NetDeviceContainer dHdSEdge = p2p.Install(NodeContainer(iHostNode, iEdgeSwtchNode));
+		uint32_t  iHostIf = AssignAddress(dHdSEdge.Get(0), Ipv4Address(base + 1), hostMask);
+		uint32_t  iEdgeIf = AssignAddress(dHdSEdge.Get(1), Ipv4Address(base + 2), hostMask);
+		AddHostAddresses(dHdSEdge.Get(0), Ipv4Address(base + 1), hostMask);
+
+		AddUpInterface(iHostNode, iHostIf);
+		AddDownRoute(iEdgeSwtchNode, Ipv4Address(base), hostMask, iEdgeIf);
+	      }
+
+	    //Edge swtch to Aggregation swtches
+	    for(int iA = 0; iA < half; ++iA)
+	      {
+		uint32_t  base = podBase | ((128 + iE) << 8) | (4 * iA);
+		Ptr<Node> iAggSwtchNode = m_aggSwtchNodes.Get(iPod * half + iA);
+		NetDeviceContainer dSEdgeSAgg = p2p.Install(NodeContainer(iEdgeSwtchNode, iAggSwtchNode));
+		uint32_t  iEdgeIf = AssignAddress(dSEdgeSAgg.Get(0), Ipv4Address(base + 1), linkMask);
+		uint32_t  iAggIf  = AssignAddress(dSEdgeSAgg.Get(1), Ipv4Address(base + 2), linkMask);
+
+		AddUpInterface(iEdgeSwtchNode, iEdgeIf);
+		AddDownRoute(iAggSwtchNode, Ipv4Address(podBase | (iE << 8)), edgeMask, iAggIf);
+	      }
+	  }
+
+	//Aggregation swtches to Core swtches
+	for(int iA = 0; iA < half; ++iA)
+	  {
+	    Ptr<Node> iAggSwtchNode = m_aggSwtchNodes.Get(iPod * half + iA);
+	    for(int iJ = 0; iJ < half; ++iJ)
+	      {
+		uint32_t  base = podBase | ((192 + iA) << 8) | (4 * iJ);
+		Ptr<Node> iCoreSwtchNode = m_coreSwtchNodes.Get(iA * half + iJ);
+		NetDeviceContainer dSAggSCore = p2p.Install(NodeContainer(iAggSwtchNode, iCoreSwtchNode));
+		uint32_t  iAggIf  = AssignAddress(dSAggSCore.Get(0), Ipv4Address(base + 1), linkMask);
+		uint32_t  iCoreIf = AssignAddress(dSAggSCore.Get(1), Ipv4Address(base + 2), linkMask);
+
+		AddUpInterface(iAggSwtchNode, iAggIf);
+		AddDownRoute(iCoreSwtchNode, Ipv4Address(podBase), podMask, iCoreIf);
+	      }
+	  }
+      }
+  }
+
+  uint32_t
+  FatTreeNetwork::AssignAddress(Ptr<NetDevice> device, Ipv4Address addr, Ipv4Mask mask)
+  {
+    Ptr<Ipv4> ipv4 = device->GetNode()->GetObject<Ipv4>();
+    int32_t   iface = ipv4->GetInterfaceForDevice(device);
+    if(iface == -1)
+      {
+	iface = ipv4->AddInterface(device);
+      }
+    ipv4->AddAddress(iface, Ipv4InterfaceAddress(addr, mask));
+    ipv4->SetMetric(iface, 1);
+    ipv4->SetUp(iface);
+    return iface;
   }
 
   void
   FatTreeNetwork::SetupGlobalRoutingTable()
   {
     NS_LOG_DEBUG("===Setup Routing Tables===");
+
+    //No RandomEcmpRouting: spraying the packets of a flow over several paths
+    //would reorder TCP and split the flow's ground truth between switches
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+  }
 
-    /*Output Routing Table Test*/
-    if(m_printRoutingTablePredicate)
+  /*FatTreeRouting goes in front of the static and global routing of every
+   *node, the tier sets which hash salt its up port choice uses.
+   */
+  void
+  FatTreeNetwork::SetupFatTreeRouting()
+  {
+    NS_LOG_DEBUG("===Setup FatTree Routing===");
+
+    NodeContainer hostNodes;
+    for(int iPod = 0; iPod < m_numPod; ++iPod) hostNodes.Add(m_podHostNodes[iPod]);
+
+    const NodeContainer* tiers[4] = {&hostNodes, &m_podSwtchNodes, &m_aggSwtchNodes, &m_coreSwtchNodes};
+    const uint32_t       levels[4] = {0, 0, 1, 2};
+    for(uint32_t iT = 0; iT < 4; ++iT)
       {
-	Ptr<OutputStreamWrapper> os = Create<OutputStreamWrapper>(&std::cout);
-	Ipv4GlobalRoutingHelper::PrintRoutingTableAllAt(Seconds(0.), os);
+	for(NodeContainer::Iterator it = tiers[iT]->Begin(); it != tiers[iT]->End(); ++it)
+	  {
+	    Ptr<FatTreeRouting> routing = CreateObject<FatTreeRouting>();
+	    routing->SetAttribute("Ecmp", BooleanValue(m_ecmpPredicate));
+	    routing->SetLevel(levels[iT]);
+	    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>((*it)->GetObject<Ipv4>()->GetRoutingProtocol());
+	    NS_ASSERT_MSG(list, "Ipv4ListRouting expected");
+	    list->AddRoutingProtocol(routing, 10);
+	  }
+      }
+  }
+
+  Ptr<FatTreeRouting>
+  FatTreeNetwork::GetFatTreeRouting(Ptr<Node> node) const
+  {
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(node->GetObject<Ipv4>()->GetRoutingProtocol());
+    for(uint32_t i = 0; list && i < list->GetNRoutingProtocols(); ++i)
+      {
+	int16_t priority;
+	Ptr<FatTreeRouting> routing = DynamicCast<FatTreeRouting>(list->GetRoutingProtocol(i, priority));
+	if(routing) return routing;
       }
+    return 0;
   }
 
-  std::vector<NodeContainer> 
+  /*The first address of a host is given, the others follow the switch side
+   *address of the link (.3, .4, ...), so they fall in the routes to the link.
+   */
+  void
+  FatTreeNetwork::AddHostAddresses(Ptr<NetDevice> device, Ipv4Address addr, Ipv4Mask mask)
+  {
+    for(int16_t i = 1; i < m_numAddrPerHost; ++i)
+      {
+	AssignAddress(device, Ipv4Address(addr.Get() + 1 + i), mask);
+      }
+  }
+
+  void
+  FatTreeNetwork::AddDownRoute(Ptr<Node> node, Ipv4Address network, Ipv4Mask mask, uint32_t iface)
+  {
+    if(m_routingMode == FATTREE_ROUTING) GetFatTreeRouting(node)->AddDownRoute(network, mask, iface);
+  }
+
+  void
+  FatTreeNetwork::AddUpInterface(Ptr<Node> node, uint32_t iface)
+  {
+    if(m_routingMode == FATTREE_ROUTING) GetFatTreeRouting(node)->AddUpInterface(iface);
+  }
+
+  /*Distributed simulation: the core switches run on rank 0 and the pods are
+   *dealt round robin over the other ranks. Without MPI everything is rank 0.
+   */
+  uint32_t
+  FatTreeNetwork::GetPodSystemId(int16_t iPod) const
+  {
+#ifdef NS3_MPI
+    if (MpiInterface::IsEnabled() && MpiInterface::GetSize() > 1)
+      {
+	return 1 + iPod % (MpiInterface::GetSize() - 1);
+      }
+#endif
+    return 0;
+  }
+
+  uint32_t
+  FatTreeNetwork::GetCoreSystemId() const
+  {
+    return 0;
+  }
+
+  int16_t
+  FatTreeNetwork::GetSwitchPod(uint32_t nodeId) const
+  {
+    std::vector<uint32_t>::const_iterator it = std::find(m_edgeIds.begin(), m_edgeIds.end(), nodeId);
+    if (it != m_edgeIds.end())
+      {
+	return (it - m_edgeIds.begin()) / m_numEdgePerPod;
+      }
+    it = std::find(m_aggIds.begin(), m_aggIds.end(), nodeId);
+    if (it != m_aggIds.end())
+      {
+	return (it - m_aggIds.begin()) / m_numAggPerPod;
+      }
+    return -1;
+  }
+
+  const std::vector<NodeContainer>&
   FatTreeNetwork::GetHostNodes() const
   {
     return m_podHostNodes;
   }
 
+  Ptr<const NeoTopologyIndex>
+  FatTreeNetwork::GetTopologyIndex() const
+  {
+    return m_topology;
+  }
+
+  NodeContainer
+  FatTreeNetwork::GetSwitchNodes() const
+  {
+    return NodeContainer(m_podSwtchNodes, m_aggSwtchNodes, m_coreSwtchNodes);
+  }
+
+  void
+  FatTreeNetwork::GetSwitchPath(const FlowField& flow, uint64_t hash, std::vector<uint32_t>& path) const
+  {
+    path.clear();
+
+    int32_t srcHost = m_topology->FindHost(flow.ipv4srcip);
+    int32_t dstHost = m_topology->FindHost(flow.ipv4dstip);
+    if (srcHost < 0 || dstHost < 0) return;
+
+    int32_t numHostPerEdge = m_numHostPerPod / m_numEdgePerPod;
+    int32_t srcEdge = srcHost / numHostPerEdge;
+    int32_t dstEdge = dstHost / numHostPerEdge;
+
+    //Host -> Edge swtch [-> Agg swtch] [-> Core swtch] [-> Agg swtch] -> Edge swtch -> Host
+    path.push_back(m_edgeIds[srcEdge]);
+    if (srcEdge == dstEdge) return;
+
+    if (m_routingMode == FATTREE_ROUTING)
+      {
+	//Follow the up port choices of FatTreeRouting
+	if (m_numAggPerPod == 0)
+	  {
+	    uint32_t iC = FatTreeRouting::SelectUp(hash, 0, m_numCore, m_ecmpPredicate);
+	    path.push_back(m_coreIds[iC]);
+	  }
+	else
+	  {
+	    int32_t  half   = m_numAggPerPod;
+	    int32_t  srcPod = srcHost / m_numHostPerPod;
+	    int32_t  dstPod = dstHost / m_numHostPerPod;
+	    uint32_t iA     = FatTreeRouting::SelectUp(hash, 0, half, m_ecmpPredicate);
+	    path.push_back(m_aggIds[srcPod * half + iA]);
+	    if (srcPod != dstPod)
+	      {
+		uint32_t iJ = FatTreeRouting::SelectUp(hash, 1, half, m_ecmpPredicate);
+		path.push_back(m_coreIds[iA * half + iJ]);
+		path.push_back(m_aggIds[dstPod * half + iA]);
+	      }
+	  }
+      }
+    else if (m_numAggPerPod == 0 && m_numCore == 1)
+      {
+	//The aggregation and core hops of global routing are only known without a choice of paths
+	path.push_back(m_coreIds[0]);
+      }
+    path.push_back(m_edgeIds[dstEdge]);
+  }
+
   
 }
@@ -6,35 +6,95 @@
 #include "ns3/object.h"
 #include "ns3/node-container.h"
 #include "ns3/net-device-container.h"
+#include "ns3/ipv4-address.h"
+
+#include "neo-topology-index.h"
 
 namespace ns3 {
+
+  class NetDevice;
+  class FatTreeRouting;
+  struct FlowField;
   
+  ///Two layouts:
+  ///FatTreeK == 0: two tiers, one edge switch per pod and NumOfCore core
+  ///               switches, every edge switch linked to every core switch.
+  ///FatTreeK == k: a k-ary fat-tree of k pods with k/2 edge and k/2 aggregation
+  ///               switches each, (k/2)^2 core switches and k/2 hosts per edge.
   class FatTreeNetwork : public Object
   {
   public:
+    enum RoutingMode
+    {
+      GLOBAL_ROUTING,  //Ipv4GlobalRoutingHelper::PopulateRoutingTables
+      FATTREE_ROUTING  //FatTreeRouting, routes from the topology
+    };
+
+    ///Addresses a host link subnet has room for, the k-ary /29 is the smallest
+    static const int16_t MAX_ADDR_PER_HOST = 5;
+
     static TypeId GetTypeId(void);
 
     FatTreeNetwork();
     
     void Initialize();
 
-    std::vector<NodeContainer> GetHostNodes() const;
+    const std::vector<NodeContainer>& GetHostNodes() const;
+    NodeContainer                     GetSwitchNodes() const;
+    ///Hosts and their addresses by (pod, host), built by Initialize
+    Ptr<const NeoTopologyIndex>       GetTopologyIndex() const;
+
+    ///Node ids of the switches a flow passes, in order. With global routing
+    ///and a choice of paths only the switches common to all of them are listed.
+    ///Thread safe once the network is set up.
+    void GetSwitchPath(const FlowField& flow, uint64_t hash, std::vector<uint32_t>& path) const;
+
+    ///Pod of an edge or aggregation switch, -1 for a core switch or another node
+    int16_t GetSwitchPod(uint32_t nodeId) const;
+
+    ///Logical process (MPI rank) simulating a pod / the core switches
+    uint32_t GetPodSystemId(int16_t iPod) const;
+    uint32_t GetCoreSystemId() const;
 
   private:
     void SetupNodes();  
     void SetupLinks();
+    void SetupTwoTierLinks();
+    void SetupKAryLinks();
     void SetupGlobalRoutingTable();
+    void SetupFatTreeRouting();
+
+    uint32_t AssignAddress(Ptr<NetDevice> device, Ipv4Address addr, Ipv4Mask mask);
+    void     AddHostAddresses(Ptr<NetDevice> device, Ipv4Address addr, Ipv4Mask mask);
+    void     AddDownRoute(Ptr<Node> node, Ipv4Address network, Ipv4Mask mask, uint32_t iface);
+    void     AddUpInterface(Ptr<Node> node, uint32_t iface);
+    Ptr<FatTreeRouting> GetFatTreeRouting(Ptr<Node> node) const;
     
+    int16_t m_fatTreeK;  //Attribute
     int16_t m_numHostPerPod;
     int16_t m_numPod;
     int16_t m_numCore;
+    int16_t m_numEdgePerPod;
+    int16_t m_numAggPerPod;
+    int16_t m_numAddrPerHost;  //Attribute
 
+    RoutingMode m_routingMode;
+    bool    m_ecmpPredicate;
     bool    m_printRoutingTablePredicate;
     bool    m_asciiTracePredicate;
     
     std::vector<NodeContainer>  m_podHostNodes;
-    NodeContainer               m_podSwtchNodes;
+    NodeContainer               m_podSwtchNodes;  //edge switches, pod by pod
+    NodeContainer               m_aggSwtchNodes;  //aggregation switches, pod by pod
     NodeContainer               m_coreSwtchNodes;
+
+    Ptr<NeoTopologyIndex>       m_topology;
+
+    //Switch node ids, GetSwitchPath reads them without touching Ptr<Node>
+    //reference counts, so it may be called from decoder threads
+    std::vector<uint32_t>       m_edgeIds;
+    std::vector<uint32_t>       m_aggIds;
+    std::vector<uint32_t>       m_coreIds;
     
 };
 
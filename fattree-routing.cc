@@ -0,0 +1,204 @@
+#include "fattree-routing.h"
+#include "neo-probe.h"
+
+#include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/output-stream-wrapper.h"
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("FatTreeRouting");
+  NS_OBJECT_ENSURE_REGISTERED(FatTreeRouting);
+
+  TypeId
+  FatTreeRouting::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::FatTreeRouting")
+      .SetParent<Ipv4RoutingProtocol> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<FatTreeRouting> ()
+      .AddAttribute("Ecmp",
+		    "Set true to spread flows over the up ports, false to always take the first",
+		    BooleanValue(true),
+		    MakeBooleanAccessor(&FatTreeRouting::m_ecmp),
+		    MakeBooleanChecker());
+
+    return tid;
+  }
+
+  FatTreeRouting::FatTreeRouting ()
+    : m_ecmp(true), m_level(0)
+  {
+  }
+
+  FatTreeRouting::~FatTreeRouting ()
+  {
+  }
+
+  void
+  FatTreeRouting::DoDispose (void)
+  {
+    m_ipv4 = 0;
+    Ipv4RoutingProtocol::DoDispose ();
+  }
+
+  void
+  FatTreeRouting::AddDownRoute (Ipv4Address network, Ipv4Mask mask, uint32_t interface)
+  {
+    //Keep the route sets ordered from the longest mask
+    std::vector<DownRouteSet>::iterator it = m_downRoutes.begin();
+    while (it != m_downRoutes.end() && it->first.GetPrefixLength() > mask.GetPrefixLength()) ++it;
+    if (it == m_downRoutes.end() || !(it->first == mask))
+      {
+	it = m_downRoutes.insert(it, DownRouteSet(mask, NetworkInterfaceMap()));
+      }
+    it->second[network.CombineMask(mask).Get()] = interface;
+  }
+
+  void
+  FatTreeRouting::AddUpInterface (uint32_t interface)
+  {
+    m_upInterfaces.push_back(interface);
+  }
+
+  void
+  FatTreeRouting::SetLevel (uint32_t level)
+  {
+    m_level = level;
+  }
+
+  uint32_t
+  FatTreeRouting::SelectUp (uint64_t hash, uint32_t level, uint32_t numUp, bool ecmp)
+  {
+    return ecmp ? FlowHashIndex(FlowHashMix(hash ^ ROUTING_SEED), level, numUp) : 0;
+  }
+
+  int32_t
+  FatTreeRouting::Lookup (Ipv4Address dst, uint64_t hash) const
+  {
+    for (uint32_t i = 0; i < m_downRoutes.size(); ++i)
+      {
+	const DownRouteSet& routes = m_downRoutes[i];
+	NetworkInterfaceMap::const_iterator it = routes.second.find(dst.CombineMask(routes.first).Get());
+	if (it != routes.second.end()) return it->second;
+      }
+
+    if (m_upInterfaces.empty()) return -1;
+    return m_upInterfaces[SelectUp(hash, m_level, m_upInterfaces.size(), m_ecmp)];
+  }
+
+  Ptr<Ipv4Route>
+  FatTreeRouting::CreateRoute (Ipv4Address dst, uint32_t interface) const
+  {
+    //Point-to-point links, no gateway needed
+    Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+    route->SetDestination(dst);
+    route->SetGateway(Ipv4Address::GetZero());
+    route->SetSource(m_ipv4->GetAddress(interface, 0).GetLocal());
+    route->SetOutputDevice(m_ipv4->GetNetDevice(interface));
+    return route;
+  }
+
+  Ptr<Ipv4Route>
+  FatTreeRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
+			       Ptr<NetDevice> oif, Socket::SocketErrno &sockerr)
+  {
+    //Locally sent packets have no L4 header yet, hash the addresses only
+    FlowField flow;
+    flow.ipv4srcip = header.GetSource().Get();
+    flow.ipv4dstip = header.GetDestination().Get();
+    flow.ipv4prot  = header.GetProtocol();
+
+    int32_t interface = Lookup(header.GetDestination(), FlowFieldHash(flow));
+    if (interface < 0 || (oif && m_ipv4->GetNetDevice(interface) != oif))
+      {
+	sockerr = Socket::ERROR_NOROUTETOHOST;
+	return 0;
+      }
+
+    sockerr = Socket::ERROR_NOTERROR;
+    return CreateRoute(header.GetDestination(), interface);
+  }
+
+  bool
+  FatTreeRouting::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
+			      Ptr<const NetDevice> idev,
+			      UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+			      LocalDeliverCallback lcb, ErrorCallback ecb)
+  {
+    Ipv4Address dst = header.GetDestination();
+    if (dst.IsMulticast() || dst.IsBroadcast()) return false;
+
+    int32_t iif = m_ipv4->GetInterfaceForDevice(idev);
+    NS_ASSERT(iif >= 0);
+    if (m_ipv4->IsDestinationAddress(dst, iif))
+      {
+	if (lcb.IsNull()) return false;
+	lcb(p, header, iif);
+	return true;
+      }
+
+    if (!m_ipv4->IsForwarding(iif))
+      {
+	ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+	return true;
+      }
+
+    //Flow hash of the probes, SelectUp remixes it the way FatTreeNetwork::GetSwitchPath does
+    FlowField flow; flow.InitFromPacket(header, p);
+    int32_t   interface = Lookup(dst, FlowFieldHash(flow));
+    if (interface < 0) return false;
+
+    ucb(CreateRoute(dst, interface), p, header);
+    return true;
+  }
+
+  void
+  FatTreeRouting::NotifyInterfaceUp (uint32_t interface)
+  {
+  }
+
+  void
+  FatTreeRouting::NotifyInterfaceDown (uint32_t interface)
+  {
+  }
+
+  void
+  FatTreeRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
+  {
+  }
+
+  void
+  FatTreeRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+  {
+  }
+
+  void
+  FatTreeRouting::SetIpv4 (Ptr<Ipv4> ipv4)
+  {
+    m_ipv4 = ipv4;
+  }
+
+  void
+  FatTreeRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
+  {
+    std::ostream* os = stream->GetStream();
+    *os << "FatTreeRouting level " << m_level << std::endl;
+    for (uint32_t i = 0; i < m_downRoutes.size(); ++i)
+      {
+	const DownRouteSet& routes = m_downRoutes[i];
+	for (NetworkInterfaceMap::const_iterator it = routes.second.begin(); it != routes.second.end(); ++it)
+	  {
+	    *os << "Down " << Ipv4Address(it->first) << "/" << routes.first.GetPrefixLength()
+		<< " if " << it->second << std::endl;
+	  }
+      }
+    for (uint32_t i = 0; i < m_upInterfaces.size(); ++i)
+      {
+	*os << "Up if " << m_upInterfaces[i] << std::endl;
+      }
+  }
+
+}
@@ -0,0 +1,74 @@
+#ifndef FATTREE_ROUTING_H
+#define FATTREE_ROUTING_H
+
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+  ///Static fat-tree routing set up from the topology instead of shortest paths.
+  ///A switch keeps prefix routes down to the hosts below it (one per port,
+  ///grouped by mask) and a list of up ports. Packets with no down route go up,
+  ///the up port is picked from the flow hash, so a flow keeps one path and
+  ///FatTreeNetwork can tell which switches it crosses.
+  class FatTreeRouting : public Ipv4RoutingProtocol
+  {
+  public:
+    static TypeId GetTypeId (void);
+
+    FatTreeRouting ();
+    virtual ~FatTreeRouting ();
+
+    void AddDownRoute (Ipv4Address network, Ipv4Mask mask, uint32_t interface);
+    ///Up ports are chosen in the order they are added
+    void AddUpInterface (uint32_t interface);
+    ///Tier of this switch, salts the up port choice so tiers choose independently
+    void SetLevel (uint32_t level);
+
+    ///The up port index a flow hash takes at a tier, from numUp ports.
+    ///The flow hash is remixed with ROUTING_SEED first: the probes take their
+    ///table indices from the same hash, and a path must not tell which cells
+    ///or rows the flow's packets update along it.
+    static uint32_t SelectUp (uint64_t hash, uint32_t level, uint32_t numUp, bool ecmp);
+
+    static const uint64_t ROUTING_SEED = 0x5bd1e9955bd1e995ULL;
+
+    virtual Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
+					Ptr<NetDevice> oif, Socket::SocketErrno &sockerr);
+    virtual bool RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
+			     Ptr<const NetDevice> idev,
+			     UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+			     LocalDeliverCallback lcb, ErrorCallback ecb);
+    virtual void NotifyInterfaceUp (uint32_t interface);
+    virtual void NotifyInterfaceDown (uint32_t interface);
+    virtual void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address);
+    virtual void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address);
+    virtual void SetIpv4 (Ptr<Ipv4> ipv4);
+    virtual void PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const;
+
+  protected:
+    virtual void DoDispose (void);
+
+  private:
+    typedef std::map<uint32_t, uint32_t>          NetworkInterfaceMap;
+    typedef std::pair<Ipv4Mask, NetworkInterfaceMap> DownRouteSet;
+
+    ///Output interface to dst, -1 if none
+    int32_t        Lookup (Ipv4Address dst, uint64_t hash) const;
+    Ptr<Ipv4Route> CreateRoute (Ipv4Address dst, uint32_t interface) const;
+
+    bool                      m_ecmp;  //Attribute
+    uint32_t                  m_level;
+    Ptr<Ipv4>                 m_ipv4;
+    std::vector<DownRouteSet> m_downRoutes;
+    std::vector<uint32_t>     m_upInterfaces;
+  };
+
+}
+
+#endif
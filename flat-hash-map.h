@@ -0,0 +1,225 @@
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+  ///Open-addressing hash map with linear probing over one flat slot array.
+  ///Hash returns a well mixed 64-bit value; its low bits pick the home slot.
+  ///Elements are never erased one by one, only all together by clear(). Each
+  ///slot is stamped with the generation it was filled in and clear() starts
+  ///a new one, so it is O(1) and stale slots are reset when they are reused.
+  template <typename Key, typename T, typename Hash>
+  class FlatHashMap
+  {
+  public:
+    typedef Key                key_type;
+    typedef T                  mapped_type;
+    typedef std::pair<Key, T>  value_type;
+
+    template <typename Value>
+    class Iterator
+    {
+    public:
+      Iterator ()
+	: m_slot(0), m_end(0), m_stamp(0), m_generation(0)
+      {
+      }
+      Iterator (Value* slot, Value* end, const uint32_t* stamp, uint32_t generation)
+	: m_slot(slot), m_end(end), m_stamp(stamp), m_generation(generation)
+      {
+	SkipEmpty ();
+      }
+      template <typename Other>
+      Iterator (const Iterator<Other>& rhs)
+	: m_slot(rhs.m_slot), m_end(rhs.m_end), m_stamp(rhs.m_stamp), m_generation(rhs.m_generation)
+      {
+      }
+
+      Value& operator*  () const { return *m_slot; }
+      Value* operator-> () const { return m_slot; }
+      Iterator& operator++ () { ++m_slot; ++m_stamp; SkipEmpty (); return *this; }
+      Iterator  operator++ (int) { Iterator it = *this; ++*this; return it; }
+      template <typename Other>
+      bool operator== (const Iterator<Other>& rhs) const { return m_slot == rhs.m_slot; }
+      template <typename Other>
+      bool operator!= (const Iterator<Other>& rhs) const { return m_slot != rhs.m_slot; }
+
+    private:
+      template <typename Other> friend class Iterator;
+
+      void SkipEmpty ()
+      {
+	while (m_slot != m_end && *m_stamp != m_generation)
+	  {
+	    ++m_slot;
+	    ++m_stamp;
+	  }
+      }
+
+      Value*          m_slot;
+      Value*          m_end;
+      const uint32_t* m_stamp;
+      uint32_t        m_generation;
+    };
+
+    typedef Iterator<value_type>       iterator;
+    typedef Iterator<const value_type> const_iterator;
+
+    FlatHashMap ()
+      : m_mask(0), m_size(0), m_generation(1)
+    {
+    }
+
+    std::size_t size  () const { return m_size; }
+    bool        empty () const { return m_size == 0; }
+    std::size_t capacity () const { return m_slots.size(); }
+
+    ///Size the slot array so that n elements fit without rehashing
+    void reserve (std::size_t n)
+    {
+      std::size_t cap = MIN_CAPACITY;
+      while (cap * MAX_LOAD_NUM < n * MAX_LOAD_DEN) cap <<= 1;
+      if (cap > m_slots.size()) Rehash (cap);
+    }
+
+    void swap (FlatHashMap& rhs)
+    {
+      m_slots.swap (rhs.m_slots);
+      m_stamps.swap (rhs.m_stamps);
+      std::swap (m_mask, rhs.m_mask);
+      std::swap (m_size, rhs.m_size);
+      std::swap (m_generation, rhs.m_generation);
+    }
+
+    void clear ()
+    {
+      m_size = 0;
+      if (++m_generation == 0)
+	{
+	  //Wrapped around, the stamps of 2^32 generations ago would look live
+	  std::fill (m_stamps.begin(), m_stamps.end(), 0);
+	  m_generation = 1;
+	}
+    }
+
+    iterator       begin  ()       { return MakeIterator (0); }
+    iterator       end    ()       { return MakeIterator (m_slots.size()); }
+    const_iterator begin  () const { return cbegin(); }
+    const_iterator end    () const { return cend(); }
+    const_iterator cbegin () const { return MakeIterator (0); }
+    const_iterator cend   () const { return MakeIterator (m_slots.size()); }
+
+    iterator       find (const Key& key)       { return find (key, m_hash(key)); }
+    const_iterator find (const Key& key) const { return find (key, m_hash(key)); }
+
+    ///Lookup with a hash the caller already computed
+    iterator find (const Key& key, uint64_t hash)
+    {
+      std::size_t i = Probe (key, hash);
+      return (i < m_slots.size() && IsLive (i)) ? MakeIterator (i) : end();
+    }
+    const_iterator find (const Key& key, uint64_t hash) const
+    {
+      std::size_t i = Probe (key, hash);
+      return (i < m_slots.size() && IsLive (i)) ? MakeIterator (i) : cend();
+    }
+
+    T& operator[] (const Key& key) { return FindOrInsert (key, m_hash(key)); }
+
+    ///Value of key, default-inserted if absent, with one probe sequence
+    T& FindOrInsert (const Key& key, uint64_t hash)
+    {
+      if ((m_size + 1) * MAX_LOAD_DEN > m_slots.size() * MAX_LOAD_NUM)
+	{
+	  Rehash (m_slots.empty() ? MIN_CAPACITY : m_slots.size() * 2);
+	}
+
+      std::size_t i    = Probe (key, hash);
+      value_type& slot = m_slots[i];
+      if (!IsLive (i))
+	{
+	  slot.first  = key;
+	  slot.second = T();
+	  m_stamps[i] = m_generation;
+	  ++m_size;
+	}
+      return slot.second;
+    }
+
+    ///Count the elements by probe length, the slots they sit past their home
+    ///slot; lengths from histogram.size() - 1 up share the last bucket
+    void ProbeLengths (std::vector<uint64_t>& histogram) const
+    {
+      for (std::size_t i = 0; i < m_slots.size(); ++i)
+	{
+	  if (!IsLive (i)) continue;
+	  std::size_t length = (i - (m_hash (m_slots[i].first) & m_mask)) & m_mask;
+	  ++histogram[std::min (length, histogram.size() - 1)];
+	}
+    }
+
+  private:
+    static const std::size_t MIN_CAPACITY = 16;
+    static const std::size_t MAX_LOAD_NUM = 3;  //max load factor 3/4
+    static const std::size_t MAX_LOAD_DEN = 4;
+
+    bool IsLive (std::size_t i) const { return m_stamps[i] == m_generation; }
+
+    iterator MakeIterator (std::size_t i)
+    {
+      value_type* data = m_slots.empty() ? 0 : &m_slots[0];
+      return iterator (data + i, data + m_slots.size(), m_stamps.empty() ? 0 : &m_stamps[i], m_generation);
+    }
+    const_iterator MakeIterator (std::size_t i) const
+    {
+      const value_type* data = m_slots.empty() ? 0 : &m_slots[0];
+      return const_iterator (data + i, data + m_slots.size(), m_stamps.empty() ? 0 : &m_stamps[i], m_generation);
+    }
+
+    ///Index of the slot holding key, or of the free slot where it belongs;
+    ///capacity() if there are no slots
+    std::size_t Probe (const Key& key, uint64_t hash) const
+    {
+      if (m_slots.empty()) return 0;
+      std::size_t i = hash & m_mask;
+      while (IsLive (i) && !(m_slots[i].first == key))
+	{
+	  i = (i + 1) & m_mask;
+	}
+      return i;
+    }
+
+    void Rehash (std::size_t cap)
+    {
+      std::vector<value_type> old (cap);
+      std::vector<uint32_t>   oldStamps (cap, 0);
+      old.swap (m_slots);
+      oldStamps.swap (m_stamps);
+      m_mask = cap - 1;
+      for (std::size_t i = 0; i < old.size(); ++i)
+	{
+	  if (oldStamps[i] != m_generation) continue;
+	  std::size_t j = Probe (old[i].first, m_hash(old[i].first));
+	  m_slots[j]  = old[i];
+	  m_stamps[j] = m_generation;
+	}
+    }
+
+    std::vector<value_type> m_slots;
+    std::vector<uint32_t>   m_stamps;     //generation each slot was filled in
+    std::size_t             m_mask;
+    std::size_t             m_size;
+    uint32_t                m_generation; //live slots carry it, never 0
+    Hash                    m_hash;
+  };
+
+}
+
+#endif
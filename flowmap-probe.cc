@@ -1,7 +1,11 @@
 #include "flowmap-probe.h"
 
-#include "ns3/node.h"
 #include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 
 namespace ns3
 {
@@ -9,18 +13,41 @@ namespace ns3
   NS_LOG_COMPONENT_DEFINE("FlowMapProbe");
   NS_OBJECT_ENSURE_REGISTERED(FlowMapProbe);
 
+  std::ostream&
+  operator<< (std::ostream& os, const FlowMapSlot& slot)
+  {
+    os << slot.flow << " " << slot.stat;
+
+    return os;
+  }
+
   TypeId 
   FlowMapProbe::GetTypeId ()
   {
     static TypeId tid = TypeId("ns3::FlowMapProbe")
       .SetParent<NeoProbe> ()
-      .SetGroupName ("NeoFlowMonitor");
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<FlowMapProbe> ()
+      .AddAttribute("NumOfCounterArrays",
+		    "The num of counter arrays of the flow map",
+		    UintegerValue(2),
+		    MakeUintegerAccessor(&FlowMapProbe::m_numArrays),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("NumOfCountersPerArray",
+		    "The num of flow slots in each counter array",
+		    UintegerValue(1024),
+		    MakeUintegerAccessor(&FlowMapProbe::m_numCounters),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("NumOfHashes",
+		    "The num of candidate slots of a flow in each counter array",
+		    UintegerValue(2),
+		    MakeUintegerAccessor(&FlowMapProbe::m_numHashes),
+		    MakeUintegerChecker<uint32_t>(1));
 
     return tid;
   }
 
-  FlowMapProbe::FlowMapProbe(Ptr<Node> node)
-    : NeoProbe(node)
+  FlowMapProbe::FlowMapProbe()
   {
   }
 
@@ -29,12 +56,128 @@ namespace ns3
   }
 
   void
-  FlowMapProbe::ForwardLogger (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload, uint32_t interface)
+  FlowMapProbe::NotifyConstructionCompleted (void)
+  {
+    NeoProbe::NotifyConstructionCompleted ();
+
+    //Attributes are only known here, allocate the fixed memory once.
+    m_slots.assign (m_numArrays * m_numCounters, FlowMapSlot());
+    m_epochSlots = m_slots;
+
+    NS_LOG_DEBUG("Arrays " << m_numArrays << " counters " << m_numCounters
+		 << " hashes " << m_numHashes);
+  }
+
+  void
+  FlowMapProbe::ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash)
   {
     //1. Update real flow stats;
-    UpdateRealFlowStats (ipHeader, ipPayload);
-    
-    return;
+    UpdateRealFlowStats (flow, hash, ipHeader.GetPayloadSize());
+
+    //2. Update the flow map;
+    Update (flow, hash, ipHeader.GetPayloadSize());
+  }
+
+  uint32_t
+  FlowMapProbe::SlotIndex (uint64_t hash, uint32_t i, uint32_t j) const
+  {
+    return i * m_numCounters + FlowHashIndex (hash, i * m_numHashes + j, m_numCounters);
+  }
+
+  void
+  FlowMapProbe::Update (const FlowField& flow, uint64_t hash, uint32_t byteCnt)
+  {
+    /*One pass over the candidates: stop at the slot holding the flow,
+     *remember the first free one. No allocation, the only data dependent
+     *branch is the key compare.
+     */
+    static const FlowField empty;
+    FlowMapSlot* free = 0;
+    for (uint32_t i = 0; i < m_numArrays; ++i)
+      {
+	for (uint32_t j = 0; j < m_numHashes; ++j)
+	  {
+	    FlowMapSlot& slot = m_slots[SlotIndex (hash, i, j)];
+	    if (slot.flow == flow)
+	      {
+		slot.stat.Add (byteCnt);
+		return;
+	      }
+	    if (!free && slot.flow == empty) free = &slot;
+	  }
+      }
+
+    PckByteField& stat = free ? free->stat : m_overflow;
+    if (free) free->flow = flow;
+    stat.Add (byteCnt);
+  }
+
+  bool
+  FlowMapProbe::Query (const FlowField& flow, uint64_t hash, PckByteField& stat) const
+  {
+    for (uint32_t i = 0; i < m_numArrays; ++i)
+      {
+	for (uint32_t j = 0; j < m_numHashes; ++j)
+	  {
+	    const FlowMapSlot& slot = m_epochSlots[SlotIndex (hash, i, j)];
+	    if (slot.flow == flow)
+	      {
+		stat = slot.stat;
+		return true;
+	      }
+	  }
+      }
+    return false;
+  }
+
+  const std::vector<FlowMapSlot>&
+  FlowMapProbe::GetEpochSlots () const
+  {
+    return m_epochSlots;
+  }
+
+  PckByteField
+  FlowMapProbe::GetEpochOverflow () const
+  {
+    return m_epochOverflow;
+  }
+
+  uint64_t
+  FlowMapProbe::GetMemoryBytes () const
+  {
+    //A padded 5-tuple and 64-bit packet and byte counters per slot
+    return m_slots.size() * (sizeof(FlowField) + 8 + 8);
+  }
+
+  void
+  FlowMapProbe::DoRollOver ()
+  {
+    m_epochSlots.swap (m_slots);
+    m_epochOverflow = m_overflow;
+    std::fill (m_slots.begin(), m_slots.end(), FlowMapSlot());
+    m_overflow = PckByteField();
+  }
+
+  void
+  FlowMapProbe::PrintMeasurementStats (std::string fileNameSuffix) const
+  {
+    std::stringstream ss;       ss << GetNodeId() << "-" << fileNameSuffix;
+    std::string       filename; ss >> filename;
+    std::ofstream     file (filename.c_str());
+    NS_ASSERT(file);
+
+    //The frozen epoch, the tables Query and GetEpochSlots answer from
+    static const FlowField empty;
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < m_epochSlots.size(); ++i) used += !(m_epochSlots[i].flow == empty);
+
+    file << "Arrays " << m_numArrays << " CountersPerArray " << m_numCounters << " Hashes " << m_numHashes
+	 << " Epochs " << GetEpoch() << " UsedSlots " << used << " Overflow " << m_epochOverflow << std::endl;
+    for (uint32_t i = 0; i < m_epochSlots.size(); ++i)
+      {
+	if (m_epochSlots[i].flow == empty) continue;
+	file << i / m_numCounters << " " << i % m_numCounters << " " << m_epochSlots[i] << std::endl;
+      }
   }
 
 }
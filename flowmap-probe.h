@@ -3,18 +3,58 @@
 
 #include "neo-probe.h"
 
+#include <vector>
+
 namespace ns3
 {
 
+  ///Flow map slot, an empty slot holds the default FlowField
+  struct FlowMapSlot
+  {
+    FlowField    flow;
+    PckByteField stat;
+  };
+  std::ostream& operator<< (std::ostream& os, const FlowMapSlot& slot);
+
+  ///FlowMap: a fixed-memory table mapping flows to their own counters.
+  ///NumOfCounterArrays arrays of NumOfCountersPerArray slots, a flow may sit
+  ///in NumOfHashes slots of every array. A packet adds to the slot holding its
+  ///flow, a new flow takes the first free candidate slot, and a flow finding
+  ///none is only counted in the overflow counters.
   class FlowMapProbe : public NeoProbe
   {
   public:
-    FlowMapProbe(Ptr<Node> node);
+    FlowMapProbe();
     virtual ~FlowMapProbe   ();
     static TypeId GetTypeId (void);
 
   public:
-    void ForwardLogger (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload, uint32_t interface);
+    void ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash);
+    void PrintMeasurementStats (std::string fileNameSuffix) const;
+
+    ///Counters of a flow in the table of the last epoch, false if not mapped
+    bool         Query (const FlowField& flow, uint64_t hash, PckByteField& stat) const;
+    const std::vector<FlowMapSlot>& GetEpochSlots () const;
+    PckByteField GetEpochOverflow () const;
+    uint64_t     GetMemoryBytes () const;
+
+  protected:
+    virtual void NotifyConstructionCompleted (void);
+    virtual void DoRollOver ();
+
+  private:
+    void Update (const FlowField& flow, uint64_t hash, uint32_t byteCnt);
+    ///Slot of the j-th candidate of a flow in array i
+    uint32_t SlotIndex (uint64_t hash, uint32_t i, uint32_t j) const;
+
+    uint32_t m_numArrays;   //Attribute
+    uint32_t m_numCounters; //Attribute
+    uint32_t m_numHashes;   //Attribute
+
+    std::vector<FlowMapSlot> m_slots;
+    std::vector<FlowMapSlot> m_epochSlots;
+    PckByteField             m_overflow;
+    PckByteField             m_epochOverflow;
   };
 
 }
@@ -0,0 +1,637 @@
+#include "flowradar-decoder.h"
+#include "fattree-network.h"
+#include "sparse-solver.h"
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/system-wall-clock-ms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("FlowRadarDecoder");
+  NS_OBJECT_ENSURE_REGISTERED(FlowRadarDecoder);
+
+  TypeId
+  FlowRadarDecoder::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::FlowRadarDecoder")
+      .SetParent<Object> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<FlowRadarDecoder> ()
+      .AddAttribute("NumOfThreads",
+		    "The num of threads decoding the switches of an epoch",
+		    UintegerValue(1),
+		    MakeUintegerAccessor(&FlowRadarDecoder::m_numThreads),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("MaxSolverIterations",
+		    "The max num of CGLS iterations for the counts substitution leaves, zero to skip",
+		    UintegerValue(200),
+		    MakeUintegerAccessor(&FlowRadarDecoder::m_maxSolverIter),
+		    MakeUintegerChecker<uint32_t>())
+      .AddAttribute("SolverTolerance",
+		    "The relative normal equation residual the CGLS solve stops at",
+		    DoubleValue(1e-6),
+		    MakeDoubleAccessor(&FlowRadarDecoder::m_solverTol),
+		    MakeDoubleChecker<double>(0.))
+      .AddAttribute("PodLocalRemoval",
+		    "Remove a decoded flow only at the switches of its pod, always on in distributed runs",
+		    BooleanValue(false),
+		    MakeBooleanAccessor(&FlowRadarDecoder::m_podLocal),
+		    MakeBooleanChecker());
+
+    return tid;
+  }
+
+  FlowRadarDecoder::FlowRadarDecoder ()
+    : m_numEpochEnds(0), m_active(0), m_round(0), m_numRunning(0), m_stop(false)
+  {
+  }
+
+  FlowRadarDecoder::~FlowRadarDecoder ()
+  {
+    StopThreads();
+  }
+
+  void
+  FlowRadarDecoder::DoDispose (void)
+  {
+    StopThreads();
+    m_switches.clear();
+    m_network = 0;
+    Object::DoDispose();
+  }
+
+  void
+  FlowRadarDecoder::Initialize (Ptr<FatTreeNetwork> network)
+  {
+    m_network = network;
+    for (uint32_t iSw = 0; iSw < m_switches.size(); ++iSw)
+      {
+	m_switches[iSw].pod = m_network->GetSwitchPod(m_switches[iSw].probe->GetNodeId());
+      }
+#ifdef NS3_MPI
+    //Removals across pods would depend on the probes of other ranks
+    if (MpiInterface::IsEnabled())
+      {
+	m_podLocal = true;
+      }
+#endif
+  }
+
+  void
+  FlowRadarDecoder::AddProbe (Ptr<FlowRadarProbe> probe)
+  {
+    NS_ASSERT_MSG(m_nodeSwitch.find(probe->GetNodeId()) == m_nodeSwitch.end(), "One probe per switch");
+
+    m_nodeSwitch[probe->GetNodeId()] = m_switches.size();
+    m_switches.push_back(SwitchState());
+    m_switches.back().probe = probe;
+    m_switches.back().pod   = m_network ? m_network->GetSwitchPod(probe->GetNodeId()) : -1;
+
+    probe->TraceConnectWithoutContext("EpochEnd", MakeCallback(&FlowRadarDecoder::NotifyEpochEnd, this));
+  }
+
+  void
+  FlowRadarDecoder::NotifyEpochEnd (Ptr<const NeoProbe> probe, uint32_t epoch)
+  {
+    //All probes roll over at the same time, decode once the last one did
+    if (++m_numEpochEnds < m_switches.size()) return;
+    m_numEpochEnds = 0;
+
+    DecodeEpoch(epoch);
+  }
+
+  void
+  FlowRadarDecoder::DecodeEpoch (uint32_t epoch)
+  {
+    NS_LOG_DEBUG("===Decode epoch " << epoch << "===");
+
+    SystemWallClockMs clock;
+    clock.Start();
+
+    //Pull every switch's encoded flowset
+    for (uint32_t iSw = 0; iSw < m_switches.size(); ++iSw)
+      {
+	SwitchState& sw = m_switches[iSw];
+	sw.numCellHashes = sw.probe->GetNumOfCellHashes();
+	sw.cells         = sw.probe->GetCountingTable();
+	sw.decoded.clear();
+	sw.flows.clear();
+	sw.incidence.clear();
+	sw.numSolved = 0;
+	sw.partial   = false;
+      }
+
+    if (m_numThreads > 1 && m_switches.size() > 1)
+      {
+	ParallelDecode();
+      }
+    else
+      {
+	FlowDecode();
+	for (uint32_t iSw = 0; iSw < m_switches.size(); ++iSw)
+	  {
+	    CountDecode(m_switches[iSw]);
+	  }
+      }
+
+    IntervalStats stats;
+    stats.interval = epoch;
+    stats.timeMs   = clock.End();
+    stats.realFlows = stats.decodedFlows = stats.correctFlows = stats.exactCntFlows = stats.solvedFlows = 0;
+    stats.partialSwitches = 0;
+    stats.cntRelError = 0.;
+
+    //Compare with the real flow stats
+    for (uint32_t iSw = 0; iSw < m_switches.size(); ++iSw)
+      {
+	SwitchState&             sw   = m_switches[iSw];
+	const FlowStatContainer& real = sw.probe->GetEpochFlowStats();
+
+	stats.realFlows    += real.size();
+	stats.decodedFlows += sw.decoded.size();
+	stats.solvedFlows  += sw.numSolved;
+	stats.partialSwitches += sw.partial;
+	for (FlowStatContainerCI ci = sw.decoded.cbegin(); ci != sw.decoded.cend(); ++ci)
+	  {
+	    FlowStatContainerCI realCi = real.find(ci->first);
+	    if (realCi == real.end()) continue;
+	    ++stats.correctFlows;
+	    if (realCi->second.pckcnt == ci->second.pckcnt) ++stats.exactCntFlows;
+	    double realCnt = realCi->second.pckcnt;
+	    stats.cntRelError += std::fabs((double)ci->second.pckcnt - realCnt) / realCnt;
+	  }
+
+	NS_LOG_DEBUG("Switch " << sw.probe->GetNodeId() << " real " << real.size()
+		     << " decoded " << sw.decoded.size());
+      }
+    if (stats.correctFlows) stats.cntRelError /= stats.correctFlows;
+    m_intervalStats.push_back(stats);
+
+    NS_LOG_INFO("Interval " << stats.interval
+		<< " decode rate " << (stats.realFlows ? (double)stats.correctFlows / stats.realFlows : 0.)
+		<< " (" << stats.correctFlows << "/" << stats.realFlows << ")"
+		<< " exact count " << stats.exactCntFlows
+		<< " solved " << stats.solvedFlows
+		<< " partly decoded switches " << stats.partialSwitches
+		<< " count error " << stats.cntRelError
+		<< " time " << stats.timeMs << "ms");
+  }
+
+  void
+  FlowRadarDecoder::SeedPureCells (uint32_t iSw, std::vector<PureCell>& pureCells) const
+  {
+    const std::vector<FlowRadarCell>& cells = m_switches[iSw].cells;
+    for (uint32_t iC = 0; iC < cells.size(); ++iC)
+      {
+	if (cells[iC].flowCnt == 1) pureCells.push_back(PureCell(iSw, iC));
+      }
+  }
+
+  bool
+  FlowRadarDecoder::IsRemovedAt (uint32_t iSw, uint32_t iFrom) const
+  {
+    if (iSw == iFrom) return false;
+    return !m_podLocal || m_switches[iSw].pod == m_switches[iFrom].pod;
+  }
+
+  void
+  FlowRadarDecoder::FlowDecode ()
+  {
+    /*Seed the worklist with the pure cells, the tables are never rescanned
+     *after this: only cells touched by a removal can turn pure.
+     */
+    m_pureCells.clear();
+    for (uint32_t iSw = 0; iSw < m_switches.size(); ++iSw)
+      {
+	SeedPureCells(iSw, m_pureCells);
+      }
+
+    while (!m_pureCells.empty())
+      {
+	PureCell pure = m_pureCells.back();
+	m_pureCells.pop_back();
+
+	FlowField flow;
+	uint64_t  hash;
+	if (!PeelCell(pure, flow, hash, m_pureCells)) continue;
+
+	//Network-wide: remove the flow from the other switches on its path
+	if (!m_network) continue;
+	m_network->GetSwitchPath(flow, hash, m_path);
+	for (uint32_t iP = 0; iP < m_path.size(); ++iP)
+	  {
+	    std::map<uint32_t, uint32_t>::const_iterator it = m_nodeSwitch.find(m_path[iP]);
+	    if (it == m_nodeSwitch.end() || !IsRemovedAt(it->second, pure.first)) continue;
+	    RemovePathFlow(it->second, flow, hash, m_pureCells);
+	  }
+      }
+  }
+
+  bool
+  FlowRadarDecoder::PeelCell (const PureCell& pure, FlowField& flow, uint64_t& hash, std::vector<PureCell>& pureCells)
+  {
+    SwitchState&         sw   = m_switches[pure.first];
+    const FlowRadarCell& cell = sw.cells[pure.second];
+    if (cell.flowCnt != 1) return false;
+
+    //A pure cell must be one of its flow's cells
+    flow = cell.flowXor;
+    hash = FlowFieldHash(flow);
+    uint32_t  numCells = sw.cells.size();
+    bool      isPure = false;
+    for (uint32_t i = 0; i < sw.numCellHashes; ++i)
+      {
+	isPure |= (FlowRadarProbe::GetCellIndex(hash, i, numCells, sw.numCellHashes) == pure.second);
+      }
+    if (!isPure || sw.decoded.find(flow) != sw.decoded.end()) return false;
+
+    RemoveFlow(pure.first, flow, hash, pureCells);
+    return true;
+  }
+
+  void
+  FlowRadarDecoder::RemovePathFlow (uint32_t iSw, const FlowField& flow, uint64_t hash, std::vector<PureCell>& pureCells)
+  {
+    SwitchState& sw = m_switches[iSw];
+    if (sw.decoded.find(flow) != sw.decoded.end()) return;
+    if (!sw.probe->IsInFlowFilter(hash)) return;
+    RemoveFlow(iSw, flow, hash, pureCells);
+  }
+
+  void
+  FlowRadarDecoder::RemoveFlow (uint32_t iSw, const FlowField& flow, uint64_t hash, std::vector<PureCell>& pureCells)
+  {
+    SwitchState& sw       = m_switches[iSw];
+    uint32_t     numCells = sw.cells.size();
+
+    sw.decoded[flow] = PckByteField();
+    sw.flows.push_back(flow);
+    for (uint32_t i = 0; i < sw.numCellHashes; ++i)
+      {
+	uint32_t       iC   = FlowRadarProbe::GetCellIndex(hash, i, numCells, sw.numCellHashes);
+	FlowRadarCell& cell = sw.cells[iC];
+	cell.flowXor.Xor(flow);
+	cell.flowCnt -= 1;
+	if (cell.flowCnt == 1) pureCells.push_back(PureCell(iSw, iC));
+	sw.incidence.push_back(iC);
+      }
+  }
+
+  /*Parallel decoding. A worker only ever writes the state of its own
+   *switches; a flow decoded at one of them is passed to the workers owning
+   *the other switches on its path in batches. m_active counts the busy
+   *workers and the batches not yet applied, decoding is done when it is 0:
+   *no worker can make new work then.
+   */
+  static const uint32_t MAX_BATCH_REMOVALS = 256;
+
+  void
+  FlowRadarDecoder::ParallelDecode ()
+  {
+    uint32_t numWorkers = std::min<uint32_t>(m_numThreads, m_switches.size());
+    if (m_workers.size() != numWorkers)
+      {
+	StopThreads();
+	std::vector<Worker>(numWorkers).swap(m_workers);
+      }
+    for (uint32_t iW = 0; iW < numWorkers; ++iW)
+      {
+	m_workers[iW].pureCells.clear();
+	m_workers[iW].outbox.assign(numWorkers, 0);
+	m_workers[iW].inbox.store(0);
+      }
+    m_active.store(numWorkers);
+
+    //Hand the epoch to the waiting threads, start them on the first one
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      ++m_round;
+      m_numRunning = numWorkers - 1;
+    }
+    m_wake.notify_all();
+    for (uint32_t iW = m_threads.size() + 1; iW < numWorkers; ++iW)
+      {
+	m_threads.push_back(std::thread(&FlowRadarDecoder::ThreadLoop, this, iW, m_round - 1));
+      }
+
+    RunWorker(0);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_numRunning == 0; });
+  }
+
+  void
+  FlowRadarDecoder::ThreadLoop (uint32_t iW, uint32_t round)
+  {
+    for (;;)
+      {
+	{
+	  std::unique_lock<std::mutex> lock(m_mutex);
+	  m_wake.wait(lock, [this, round] { return m_stop || m_round != round; });
+	  if (m_stop) return;
+	  round = m_round;
+	}
+	RunWorker(iW);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (--m_numRunning == 0) m_done.notify_one();
+      }
+  }
+
+  void
+  FlowRadarDecoder::StopThreads ()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (uint32_t iT = 0; iT < m_threads.size(); ++iT)
+      {
+	m_threads[iT].join();
+      }
+    m_threads.clear();
+    m_stop = false;
+  }
+
+  void
+  FlowRadarDecoder::NotifyWorkers ()
+  {
+    //A waiter checks its condition under the mutex, so it either sees the
+    //change or is already waiting when the notification comes
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_wake.notify_all();
+  }
+
+  void
+  FlowRadarDecoder::RunWorker (uint32_t iW)
+  {
+    Worker&  w          = m_workers[iW];
+    uint32_t numWorkers = m_workers.size();
+    for (uint32_t iSw = iW; iSw < m_switches.size(); iSw += numWorkers)
+      {
+	SeedPureCells(iSw, w.pureCells);
+      }
+
+    for (;;)
+      {
+	//Busy: apply the received removals and peel until nothing is left
+	for (;;)
+	  {
+	    RemoveBatch* batch = w.inbox.exchange(0, std::memory_order_acquire);
+	    if (!batch && w.pureCells.empty()) break;
+	    while (batch)
+	      {
+		for (uint32_t i = 0; i < batch->removals.size(); ++i)
+		  {
+		    const RemoveBatch::Removal& r = batch->removals[i];
+		    RemovePathFlow(r.iSw, r.flow, r.hash, w.pureCells);
+		  }
+		RemoveBatch* next = batch->next;
+		delete batch;
+		batch = next;
+		if (m_active.fetch_sub(1, std::memory_order_acq_rel) == 1) NotifyWorkers();
+	      }
+	    PeelWorker(iW);
+	  }
+
+	//Idle: wait for a new batch, stop once nobody is busy
+	if (m_active.fetch_sub(1, std::memory_order_acq_rel) == 1) NotifyWorkers();
+	{
+	  std::unique_lock<std::mutex> lock(m_mutex);
+	  m_wake.wait(lock, [this, &w] {
+	      return w.inbox.load(std::memory_order_acquire) || m_active.load(std::memory_order_acquire) == 0;
+	    });
+	}
+	//Batches in flight are counted in m_active, so a full inbox means it is not zero
+	if (!w.inbox.load(std::memory_order_acquire)) break;
+	m_active.fetch_add(1, std::memory_order_acq_rel);
+      }
+
+    for (uint32_t iSw = iW; iSw < m_switches.size(); iSw += numWorkers)
+      {
+	CountDecode(m_switches[iSw]);
+      }
+  }
+
+  void
+  FlowRadarDecoder::PeelWorker (uint32_t iW)
+  {
+    Worker&  w          = m_workers[iW];
+    uint32_t numWorkers = m_workers.size();
+    while (!w.pureCells.empty())
+      {
+	PureCell pure = w.pureCells.back();
+	w.pureCells.pop_back();
+
+	FlowField flow;
+	uint64_t  hash;
+	if (!PeelCell(pure, flow, hash, w.pureCells)) continue;
+
+	if (!m_network) continue;
+	m_network->GetSwitchPath(flow, hash, w.path);
+	for (uint32_t iP = 0; iP < w.path.size(); ++iP)
+	  {
+	    std::map<uint32_t, uint32_t>::const_iterator it = m_nodeSwitch.find(w.path[iP]);
+	    if (it == m_nodeSwitch.end() || !IsRemovedAt(it->second, pure.first)) continue;
+
+	    uint32_t iDst = it->second % numWorkers;
+	    if (iDst == iW)
+	      {
+		RemovePathFlow(it->second, flow, hash, w.pureCells);
+		continue;
+	      }
+
+	    if (!w.outbox[iDst]) w.outbox[iDst] = new RemoveBatch();
+	    RemoveBatch::Removal r;
+	    r.iSw  = it->second;
+	    r.flow = flow;
+	    r.hash = hash;
+	    w.outbox[iDst]->removals.push_back(r);
+	    if (w.outbox[iDst]->removals.size() == MAX_BATCH_REMOVALS) SendBatch(iW, iDst);
+	  }
+      }
+
+    for (uint32_t iDst = 0; iDst < numWorkers; ++iDst)
+      {
+	if (w.outbox[iDst]) SendBatch(iW, iDst);
+      }
+  }
+
+  void
+  FlowRadarDecoder::SendBatch (uint32_t iW, uint32_t iDst)
+  {
+    RemoveBatch* batch = m_workers[iW].outbox[iDst];
+    m_workers[iW].outbox[iDst] = 0;
+
+    //Counted before it can be seen, so m_active stays > 0 until it is applied
+    m_active.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic<RemoveBatch*>& inbox = m_workers[iDst].inbox;
+    batch->next = inbox.load(std::memory_order_relaxed);
+    while (!inbox.compare_exchange_weak(batch->next, batch, std::memory_order_release, std::memory_order_relaxed))
+      {
+      }
+    NotifyWorkers();
+  }
+
+  void
+  FlowRadarDecoder::CountDecode (SwitchState& sw)
+  {
+    /*Each cell gives one equation: the sum of its flows' packet counts is its
+     *PacketCount. A cell with one unknown flow left solves that flow, which is
+     *then substituted into its other cells. The unknown flow of a cell is
+     *tracked as the XOR of the unknown flow indices, so no cell lists are kept.
+     */
+    const std::vector<FlowRadarCell>& table = sw.probe->GetCountingTable();
+    uint32_t numCells = table.size();
+    uint32_t numFlows = sw.flows.size();
+    uint32_t k        = sw.numCellHashes;
+
+    std::vector<int64_t>  residual (numCells);
+    std::vector<uint32_t> unknownCnt (numCells, 0);
+    std::vector<uint32_t> unknownXor (numCells, 0);
+    for (uint32_t iC = 0; iC < numCells; ++iC)
+      {
+	residual[iC] = table[iC].pckCnt;
+      }
+    for (uint32_t iF = 0; iF < numFlows; ++iF)
+      {
+	for (uint32_t i = 0; i < k; ++i)
+	  {
+	    uint32_t iC = sw.incidence[iF * k + i];
+	    unknownCnt[iC] += 1;
+	    unknownXor[iC] ^= iF;
+	  }
+      }
+
+    /*A cell flow decoding left flows in also counts their packets, it is no
+     *equation of the decoded flows. Its switch is partly decoded: counts are
+     *only substituted from the other cells and the least squares solve over
+     *too few equations is skipped.
+     */
+    for (uint32_t iC = 0; iC < numCells; ++iC)
+      {
+	if (sw.cells[iC].flowCnt != 0) sw.partial = true;
+      }
+
+    std::vector<uint8_t>  solved (numFlows, 0);
+    std::vector<uint32_t> solvable;
+    for (uint32_t iC = 0; iC < numCells; ++iC)
+      {
+	if (unknownCnt[iC] == 1 && sw.cells[iC].flowCnt == 0) solvable.push_back(iC);
+      }
+
+    while (!solvable.empty())
+      {
+	uint32_t iC = solvable.back();
+	solvable.pop_back();
+	if (unknownCnt[iC] != 1 || sw.cells[iC].flowCnt != 0) continue;
+
+	//Inconsistent cells (a mis-peeled flow, counts of another epoch) can
+	//leave a residual below 1; a decoded flow sent at least one packet
+	uint32_t iF     = unknownXor[iC];
+	int64_t  pckCnt = residual[iC] < 1 ? 1 : residual[iC];
+	sw.decoded[sw.flows[iF]].pckcnt = pckCnt;
+
+	for (uint32_t i = 0; i < k; ++i)
+	  {
+	    uint32_t iFC = sw.incidence[iF * k + i];
+	    residual[iFC]   -= pckCnt;
+	    unknownCnt[iFC] -= 1;
+	    unknownXor[iFC] ^= iF;
+	    if (unknownCnt[iFC] == 1) solvable.push_back(iFC);
+	  }
+	solved[iF] = 1;
+      }
+
+    /*Flows still unknown share cells with other unknown flows only. Their
+     *cells' residuals are solved in the least squares sense over the sparse
+     *cell x flow incidence matrix, built from the decoding incidence.
+     */
+    std::vector<uint32_t> unknownFlows;
+    for (uint32_t iF = 0; iF < numFlows; ++iF)
+      {
+	if (!solved[iF]) unknownFlows.push_back(iF);
+      }
+    if (unknownFlows.empty() || m_maxSolverIter == 0 || sw.partial) return;
+
+    std::vector<uint32_t> row (numCells, 0);
+    CsrMatrix             a;
+    std::vector<double>   b;
+    a.rowPtr.push_back(0);
+    for (uint32_t iC = 0; iC < numCells; ++iC)
+      {
+	if (unknownCnt[iC] == 0) continue;
+	row[iC] = a.numRows++;
+	a.rowPtr.push_back(a.rowPtr.back() + unknownCnt[iC]);
+	b.push_back(residual[iC]);
+      }
+    a.numCols = unknownFlows.size();
+    a.colIdx.resize(a.rowPtr.back());
+    a.values.assign(a.rowPtr.back(), 1.);
+
+    std::vector<uint32_t> fill (a.rowPtr.begin(), a.rowPtr.end() - 1);
+    for (uint32_t iU = 0; iU < unknownFlows.size(); ++iU)
+      {
+	for (uint32_t i = 0; i < k; ++i)
+	  {
+	    uint32_t iC = sw.incidence[unknownFlows[iU] * k + i];
+	    a.colIdx[fill[row[iC]]++] = iU;
+	  }
+      }
+
+    std::vector<double> x;
+    CglsSolve(a, b, x, m_maxSolverIter, m_solverTol);
+    for (uint32_t iU = 0; iU < unknownFlows.size(); ++iU)
+      {
+	//A decoded flow sent at least one packet
+	int64_t pckCnt = x[iU] < 1. ? 1 : (int64_t)std::floor(x[iU] + 0.5);
+	sw.decoded[sw.flows[unknownFlows[iU]]].pckcnt = pckCnt;
+      }
+    sw.numSolved = unknownFlows.size();
+  }
+
+  const std::vector<FlowRadarDecoder::IntervalStats>&
+  FlowRadarDecoder::GetIntervalStats () const
+  {
+    return m_intervalStats;
+  }
+
+  void
+  FlowRadarDecoder::PrintDecodeStats (std::string fileName) const
+  {
+    std::ofstream file (fileName.c_str());
+    NS_ASSERT(file);
+
+    file << "Switches " << m_switches.size() << " Intervals " << m_intervalStats.size() << std::endl;
+    for (uint32_t i = 0; i < m_intervalStats.size(); ++i)
+      {
+	const IntervalStats& stats = m_intervalStats[i];
+	file << "Interval "      << stats.interval
+	     << " RealFlows "    << stats.realFlows
+	     << " DecodedFlows " << stats.decodedFlows
+	     << " CorrectFlows " << stats.correctFlows
+	     << " ExactCnt "     << stats.exactCntFlows
+	     << " SolvedCnt "    << stats.solvedFlows
+	     << " PartialSw "    << stats.partialSwitches
+	     << " CntRelError "  << stats.cntRelError
+	     << " DecodeRate "   << (stats.realFlows ? (double)stats.correctFlows / stats.realFlows : 0.)
+	     << " TimeMs "       << stats.timeMs << std::endl;
+      }
+  }
+
+}
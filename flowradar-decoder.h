@@ -0,0 +1,166 @@
+#ifndef FLOWRADAR_DECODER_H
+#define FLOWRADAR_DECODER_H
+
+#include "flowradar-probe.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+  class FatTreeNetwork;
+
+  ///Network-wide FlowRadar decoding of all switches' encoded flowsets,
+  ///run when every probe has frozen its tables at the end of an epoch.
+  ///1.FlowDecode: pure cells are peeled from a worklist; a flow decoded at one
+  ///  switch is also removed from the other switches on its path, which may
+  ///  make new cells pure there.
+  ///2.CountDecode: per switch, packet counts are solved from the counting table
+  ///  cells' PacketCount equations of the decoded flows, by substitution and,
+  ///  for the flows left, by a sparse least squares solve (CGLS). Cells still
+  ///  holding undecoded flows are no equations, and a switch with such cells
+  ///  gets no least squares solve.
+  ///With NumOfThreads > 1 the switches are split over worker threads. Each
+  ///peels its own switches and sends flows to remove at other workers'
+  ///switches through lock-free inboxes, until no worker has work left.
+  ///The threads are started once and kept; between epochs and while idle
+  ///they wait on a condition variable.
+  ///With PodLocalRemoval, and always in a distributed run, step 1 only
+  ///removes a flow at switches of the pod it was decoded in (the core
+  ///switches count as one group). Every group is simulated on one MPI rank, so
+  ///the results of a switch do not depend on how the pods are split.
+  class FlowRadarDecoder : public Object
+  {
+  public:
+    ///Per interval report
+    struct IntervalStats
+    {
+      uint32_t interval;
+      uint64_t realFlows;
+      uint64_t decodedFlows;
+      uint64_t correctFlows;
+      uint64_t exactCntFlows;
+      uint64_t solvedFlows;
+      uint32_t partialSwitches; //switches with flows left in their cells
+      double   cntRelError;  //average over the correct flows
+      int64_t  timeMs;
+    };
+
+    static TypeId GetTypeId (void);
+
+    FlowRadarDecoder ();
+    virtual ~FlowRadarDecoder ();
+
+    ///Without a network every switch is decoded on its own
+    void Initialize (Ptr<FatTreeNetwork> network);
+    void AddProbe (Ptr<FlowRadarProbe> probe);
+
+    ///Decode the frozen epoch of all probes and compare with their real flow stats
+    void DecodeEpoch (uint32_t epoch);
+    const std::vector<IntervalStats>& GetIntervalStats () const;
+    void PrintDecodeStats (std::string fileName) const;
+
+  protected:
+    virtual void DoDispose (void);
+
+  private:
+    ///Decoding state of one switch
+    struct SwitchState
+    {
+      Ptr<FlowRadarProbe>        probe;
+      int16_t                    pod;        //-1 for the core switches
+      uint32_t                   numCellHashes;
+      std::vector<FlowRadarCell> cells;      //working copy, peeled in place
+      FlowStatContainer          decoded;    //decoded flow -> PckByteField
+      std::vector<FlowField>     flows;      //decoded flows in decode order
+      std::vector<uint32_t>      incidence;  //numCellHashes cell indices per decoded flow
+      uint32_t                   numSolved;  //flows counted by the least squares solve
+      bool                       partial;    //flow decoding left flows in its cells
+    };
+
+    typedef std::pair<uint32_t, uint32_t> PureCell; //(switch, cell)
+
+    ///Flows to remove at switches of one worker, pushed to its inbox as a whole
+    struct RemoveBatch
+    {
+      struct Removal
+      {
+	uint32_t  iSw;
+	FlowField flow;
+	uint64_t  hash;
+      };
+      RemoveBatch*         next;
+      std::vector<Removal> removals;
+    };
+
+    ///Decoding thread, owns the switches with iSw % NumOfThreads == its index
+    struct Worker
+    {
+      std::vector<PureCell>     pureCells;
+      std::vector<uint32_t>     path;
+      std::vector<RemoveBatch*> outbox;  //per destination worker
+      std::atomic<RemoveBatch*> inbox;   //lock-free stack, many producers, one consumer
+
+      Worker ()
+	: inbox(0)
+      {
+      }
+    };
+
+    void NotifyEpochEnd (Ptr<const NeoProbe> probe, uint32_t epoch);
+    void FlowDecode ();
+    void CountDecode (SwitchState& sw);
+    void RemoveFlow (uint32_t iSw, const FlowField& flow, uint64_t hash, std::vector<PureCell>& pureCells);
+    ///Decode the flow of a pure cell at its switch, false if the cell is not really pure
+    bool PeelCell (const PureCell& pure, FlowField& flow, uint64_t& hash, std::vector<PureCell>& pureCells);
+    ///Remove a flow decoded elsewhere, if it also passed this switch
+    void RemovePathFlow (uint32_t iSw, const FlowField& flow, uint64_t hash, std::vector<PureCell>& pureCells);
+    void SeedPureCells (uint32_t iSw, std::vector<PureCell>& pureCells) const;
+    ///A flow decoded at switch iFrom is also removed at switch iSw
+    bool IsRemovedAt (uint32_t iSw, uint32_t iFrom) const;
+
+    void ParallelDecode ();
+    ///Thread of worker iW > 0, runs RunWorker once per parallel epoch after round
+    void ThreadLoop (uint32_t iW, uint32_t round);
+    void StopThreads ();
+    ///Wake the waiting workers, after a batch was sent or m_active dropped to zero
+    void NotifyWorkers ();
+    void RunWorker (uint32_t iW);
+    void PeelWorker (uint32_t iW);
+    void SendBatch (uint32_t iW, uint32_t iDst);
+
+    uint32_t                     m_numThreads;    //Attribute
+    uint32_t                     m_maxSolverIter; //Attribute
+    double                       m_solverTol;     //Attribute
+    bool                         m_podLocal;      //Attribute
+
+    Ptr<FatTreeNetwork>          m_network;
+    std::vector<SwitchState>     m_switches;
+    std::map<uint32_t, uint32_t> m_nodeSwitch;    //node id -> m_switches index
+    std::vector<PureCell>        m_pureCells;     //worklist
+    std::vector<uint32_t>        m_path;
+
+    uint32_t                     m_numEpochEnds;  //probes done with the current epoch
+    std::vector<IntervalStats>   m_intervalStats;
+
+    std::vector<Worker>          m_workers;
+    std::atomic<uint32_t>        m_active;        //busy workers + batches in flight
+    std::vector<std::thread>     m_threads;       //workers 1.., worker 0 is the caller
+    std::mutex                   m_mutex;
+    std::condition_variable      m_wake;          //new round, batch, m_active zero or stop
+    std::condition_variable      m_done;          //m_numRunning zero
+    uint32_t                     m_round;         //parallel epochs started
+    uint32_t                     m_numRunning;    //threads still in the round
+    bool                         m_stop;
+  };
+
+}
+
+#endif
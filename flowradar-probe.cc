@@ -1,7 +1,12 @@
 #include "flowradar-probe.h"
 
-#include "ns3/node.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 
 namespace ns3
 {
@@ -9,20 +14,48 @@ namespace ns3
   NS_LOG_COMPONENT_DEFINE("FlowRadarProbe");
   NS_OBJECT_ENSURE_REGISTERED(FlowRadarProbe);
 
-  TypeId 
+  std::ostream&
+  operator<< (std::ostream& os, const FlowRadarCell& cell)
+  {
+    os << cell.flowXor << " FlowCnt " << cell.flowCnt << " PckCnt " << cell.pckCnt;
+
+    return os;
+  }
+
+  TypeId
   FlowRadarProbe::GetTypeId()
   {
 
     static TypeId tid = TypeId("ns3::FlowRadarProbe")
       .SetParent<NeoProbe> ()
-      .SetGroupName ("NeoFlowMonitor");
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<FlowRadarProbe> ()
+      .AddAttribute("NumOfCells",
+		    "The num of cells in the counting table, at least NumOfCellHashes",
+		    UintegerValue(2048),
+		    MakeUintegerAccessor(&FlowRadarProbe::m_numCells),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("NumOfCellHashes",
+		    "The num of counting table cells each flow is hashed to",
+		    UintegerValue(3),
+		    MakeUintegerAccessor(&FlowRadarProbe::m_numCellHashes),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("NumOfFilterBits",
+		    "The num of bits in the flow filter",
+		    UintegerValue(16384),
+		    MakeUintegerAccessor(&FlowRadarProbe::m_numFilterBits),
+		    MakeUintegerChecker<uint32_t>(64))
+      .AddAttribute("NumOfFilterHashes",
+		    "The num of flow filter bits each flow sets",
+		    UintegerValue(4),
+		    MakeUintegerAccessor(&FlowRadarProbe::m_numFilterHashes),
+		    MakeUintegerChecker<uint32_t>(1));
 
     return tid;
 
   }
 
-  FlowRadarProbe::FlowRadarProbe (Ptr<Node> node) 
-    : NeoProbe(node)
+  FlowRadarProbe::FlowRadarProbe ()
   {
     NS_LOG_FUNCTION(this);
   }
@@ -32,10 +65,125 @@ namespace ns3
   }
 
   void
-  FlowRadarProbe::ForwardLogger (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload, uint32_t interface)
+  FlowRadarProbe::NotifyConstructionCompleted (void)
+  {
+    NeoProbe::NotifyConstructionCompleted ();
+
+    //Attributes are only known here, allocate the fixed memory once.
+    NS_ABORT_MSG_IF(m_numCells < m_numCellHashes,
+		    "NumOfCells " << m_numCells << " is less than NumOfCellHashes " << m_numCellHashes);
+    m_flowFilter.assign ((m_numFilterBits + 63) / 64, 0);
+    m_countingTable.assign (m_numCells, FlowRadarCell());
+    m_epochFlowFilter = m_flowFilter;
+    m_epochCountingTable = m_countingTable;
+
+    NS_LOG_DEBUG("Cells " << m_numCells << " k " << m_numCellHashes
+		 << " filter bits " << m_numFilterBits << " kf " << m_numFilterHashes);
+  }
+
+  void
+  FlowRadarProbe::ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash)
+  {
+    //1. Update real flow stats;
+    UpdateRealFlowStats (flow, hash, ipHeader.GetPayloadSize());
+
+    //2. Update the encoded flowset;
+    Encode (flow, hash);
+  }
+
+  void
+  FlowRadarProbe::Encode (const FlowField& flow, uint64_t hash)
+  {
+    /*Flow filter: the flow is new if any of its bits was not set yet.
+     *Filter indices follow the cell indices in the same hash sequence.
+     */
+    uint64_t isNew = 0;
+    for (uint32_t i = 0; i < m_numFilterHashes; ++i)
+      {
+	uint32_t  idx  = FlowHashIndex (hash, m_numCellHashes + i, m_numFilterBits);
+	uint64_t& word = m_flowFilter[idx >> 6];
+	uint64_t  bit  = (uint64_t)1 << (idx & 63);
+	isNew |= ~word & bit;
+	word  |= bit;
+      }
+
+    /*Counting table: a new flow is xored into FlowXOR and counted in FlowCount,
+     *every packet is counted in PacketCount.
+     */
+    FlowField flowXor;
+    if (isNew) flowXor = flow;
+    uint32_t  newCnt = isNew ? 1 : 0;
+    for (uint32_t i = 0; i < m_numCellHashes; ++i)
+      {
+	FlowRadarCell& cell = m_countingTable[GetCellIndex (hash, i, m_numCells, m_numCellHashes)];
+	cell.flowXor.Xor (flowXor);
+	cell.flowCnt += newCnt;
+	cell.pckCnt  += 1;
+      }
+  }
+
+  const std::vector<FlowRadarCell>&
+  FlowRadarProbe::GetCountingTable () const
+  {
+    return m_epochCountingTable;
+  }
+
+  bool
+  FlowRadarProbe::IsInFlowFilter (uint64_t hash) const
+  {
+    for (uint32_t i = 0; i < m_numFilterHashes; ++i)
+      {
+	uint32_t idx = FlowHashIndex (hash, m_numCellHashes + i, m_numFilterBits);
+	if (!(m_epochFlowFilter[idx >> 6] & ((uint64_t)1 << (idx & 63)))) return false;
+      }
+    return true;
+  }
+
+  uint32_t
+  FlowRadarProbe::GetNumOfCellHashes () const
+  {
+    return m_numCellHashes;
+  }
+
+  uint64_t
+  FlowRadarProbe::GetMemoryBytes () const
+  {
+    //The filter bits, and a padded FlowXOR and two 32-bit counts per cell
+    return (m_numFilterBits + 7) / 8 + (uint64_t)m_numCells * (sizeof(FlowField) + 4 + 4);
+  }
+
+  void
+  FlowRadarProbe::DoRollOver ()
   {
-    NS_LOG_FUNCTION("radar forward");
-    return;
+    m_epochFlowFilter.swap (m_flowFilter);
+    m_epochCountingTable.swap (m_countingTable);
+    std::fill (m_flowFilter.begin(), m_flowFilter.end(), 0);
+    std::fill (m_countingTable.begin(), m_countingTable.end(), FlowRadarCell());
+  }
+
+  void
+  FlowRadarProbe::PrintMeasurementStats (std::string fileNameSuffix) const
+  {
+    std::stringstream ss;       ss << GetNodeId() << "-" << fileNameSuffix;
+    std::string       filename; ss >> filename;
+    std::ofstream     file (filename.c_str());
+    NS_ASSERT(file);
+
+    file << "CellCnt " << m_numCells << " CellHashes " << m_numCellHashes
+	 << " FilterBits " << m_numFilterBits << " FilterHashes " << m_numFilterHashes
+	 << " Epochs " << GetEpoch() << std::endl;
+    //The frozen table is the one GetCountingTable serves and the decoder reads,
+    //the current one still counts the open epoch
+    file << "EpochTable" << std::endl;
+    for (uint32_t i = 0; i < m_numCells; ++i)
+      {
+	file << i << " " << m_epochCountingTable[i] << std::endl;
+      }
+    file << "CurrentTable" << std::endl;
+    for (uint32_t i = 0; i < m_numCells; ++i)
+      {
+	file << i << " " << m_countingTable[i] << std::endl;
+      }
   }
 
 }
@@ -3,20 +3,77 @@
 
 #include "neo-probe.h"
 
+#include <vector>
+
 namespace ns3
 {
 
+  ///Counting table cell
+  struct FlowRadarCell
+  {
+    FlowField flowXor;
+    uint32_t  flowCnt;
+    uint32_t  pckCnt;
+
+    FlowRadarCell ()
+      : flowCnt(0), pckCnt(0)
+    {
+    }
+  };
+  std::ostream& operator<< (std::ostream& os, const FlowRadarCell& cell);
+
+  ///FlowRadar encoded flowset: a flow filter (bloom filter) telling new flows
+  ///apart, and a counting table of FlowXOR, FlowCount and PacketCount cells.
+  ///Both are allocated once from the attributes, never resized. The counting
+  ///table is split into NumOfCellHashes sub-tables, the i-th hash of a flow
+  ///picks a cell of the i-th, so the cells of a flow are always distinct.
   class FlowRadarProbe : public NeoProbe
   {
   public:
-    FlowRadarProbe (Ptr<Node> node);
+    FlowRadarProbe ();
     virtual ~FlowRadarProbe ();
     static TypeId GetTypeId (void);
 
   public:
-    void ForwardLogger (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload, uint32_t interface);
+    void ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash);
+    void PrintMeasurementStats (std::string fileNameSuffix) const;
+
+    ///Encoded flowset of the last epoch, for the decoder
+    const std::vector<FlowRadarCell>& GetCountingTable () const;
+    bool     IsInFlowFilter (uint64_t hash) const;
+    uint32_t GetNumOfCellHashes () const;
+    uint64_t GetMemoryBytes () const;
+
+    ///The cell the i-th of k hashes of a flow picks in a table of numCells
+    static uint32_t GetCellIndex (uint64_t hash, uint32_t i, uint32_t numCells, uint32_t k);
+
+  protected:
+    virtual void NotifyConstructionCompleted (void);
+    virtual void DoRollOver ();
+
+  private:
+    void Encode (const FlowField& flow, uint64_t hash);
+
+    uint32_t m_numCells;         //Attribute
+    uint32_t m_numCellHashes;    //Attribute
+    uint32_t m_numFilterBits;    //Attribute
+    uint32_t m_numFilterHashes;  //Attribute
+
+    std::vector<uint64_t>      m_flowFilter;
+    std::vector<FlowRadarCell> m_countingTable;
+    std::vector<uint64_t>      m_epochFlowFilter;
+    std::vector<FlowRadarCell> m_epochCountingTable;
   };
 
+  inline uint32_t
+  FlowRadarProbe::GetCellIndex (uint64_t hash, uint32_t i, uint32_t numCells, uint32_t k)
+  {
+    //Sub-table i is [i * numCells / k, (i + 1) * numCells / k)
+    uint32_t first = (uint64_t)i * numCells / k;
+    uint32_t last  = (uint64_t)(i + 1) * numCells / k;
+    return first + FlowHashIndex (hash, i, last - first);
+  }
+
 }
 
 #endif
@@ -0,0 +1,137 @@
+#include "hashpipe-probe.h"
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("HashPipeProbe");
+  NS_OBJECT_ENSURE_REGISTERED(HashPipeProbe);
+
+  TypeId
+  HashPipeProbe::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::HashPipeProbe")
+      .SetParent<HeavyHitterProbe> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<HashPipeProbe> ()
+      .AddAttribute("NumOfStages",
+		    "The num of pipe stages, one hash each",
+		    UintegerValue(4),
+		    MakeUintegerAccessor(&HashPipeProbe::m_numStages),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("NumOfSlots",
+		    "The num of flow slots per stage",
+		    UintegerValue(256),
+		    MakeUintegerAccessor(&HashPipeProbe::m_numSlots),
+		    MakeUintegerChecker<uint32_t>(1));
+
+    return tid;
+  }
+
+  HashPipeProbe::HashPipeProbe ()
+  {
+  }
+
+  HashPipeProbe::~HashPipeProbe ()
+  {
+  }
+
+  void
+  HashPipeProbe::NotifyConstructionCompleted (void)
+  {
+    HeavyHitterProbe::NotifyConstructionCompleted ();
+    m_slots.assign (m_numStages * m_numSlots, HeavyHitter());
+  }
+
+  void
+  HashPipeProbe::ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash)
+  {
+    uint32_t byteCnt = ipHeader.GetPayloadSize();
+
+    //1. Update real flow stats;
+    UpdateRealFlowStats (flow, hash, byteCnt);
+
+    //2. First stage: add to the own slot or take it over;
+    HeavyHitter& first = m_slots[FlowHashIndex (hash, 0, m_numSlots)];
+    if (first.bytes == 0 || (first.hash == hash && first.flow == flow))
+      {
+	first.flow   = flow;
+	first.hash   = hash;
+	first.bytes += byteCnt;
+	return;
+      }
+
+    HeavyHitter carried = first;
+    first.flow  = flow;
+    first.hash  = hash;
+    first.bytes = byteCnt;
+
+    //3. Later stages: merge, fill an empty slot or keep the larger flow;
+    for (uint32_t i = 1; i < m_numStages; ++i)
+      {
+	HeavyHitter& slot = m_slots[i * m_numSlots + FlowHashIndex (carried.hash, i, m_numSlots)];
+	if (slot.bytes == 0 || (slot.hash == carried.hash && slot.flow == carried.flow))
+	  {
+	    carried.bytes += slot.bytes;
+	    slot = carried;
+	    return;
+	  }
+	if (slot.bytes < carried.bytes) std::swap (slot, carried);
+      }
+  }
+
+  uint64_t
+  HashPipeProbe::Estimate (const FlowField& flow, uint64_t hash) const
+  {
+    //A flow may sit in several stages after evictions, its bytes add up
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < m_numStages; ++i)
+      {
+	const HeavyHitter& slot = m_slots[i * m_numSlots + FlowHashIndex (hash, i, m_numSlots)];
+	if (slot.bytes && slot.hash == hash && slot.flow == flow) bytes += slot.bytes;
+      }
+    return bytes;
+  }
+
+  void
+  HashPipeProbe::GetCandidates (std::vector<HeavyHitter>& candidates) const
+  {
+    candidates.clear();
+    for (uint32_t i = 0; i < m_slots.size(); ++i)
+      {
+	const HeavyHitter& slot = m_slots[i];
+	if (slot.bytes == 0) continue;
+
+	//Report each flow once, from the first stage it sits in
+	uint32_t stage = i / m_numSlots;
+	bool     first = true;
+	for (uint32_t j = 0; j < stage && first; ++j)
+	  {
+	    const HeavyHitter& other = m_slots[j * m_numSlots + FlowHashIndex (slot.hash, j, m_numSlots)];
+	    first = !(other.bytes && other.hash == slot.hash && other.flow == slot.flow);
+	  }
+	if (!first) continue;
+
+	candidates.push_back(slot);
+	candidates.back().bytes = Estimate (slot.flow, slot.hash);
+      }
+  }
+
+  uint64_t
+  HashPipeProbe::GetMemoryBytes () const
+  {
+    //A switch keeps the padded 5-tuple and the 64-bit byte counter per slot
+    return m_slots.size() * (sizeof(FlowField) + sizeof(uint64_t));
+  }
+
+  void
+  HashPipeProbe::ClearSketch ()
+  {
+    std::fill (m_slots.begin(), m_slots.end(), HeavyHitter());
+  }
+
+}
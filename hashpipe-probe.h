@@ -0,0 +1,42 @@
+#ifndef HASHPIPE_PROBE_H
+#define HASHPIPE_PROBE_H
+
+#include "heavy-hitter-probe.h"
+
+#include <vector>
+
+namespace ns3
+{
+
+  ///HashPipe: NumOfStages tables of NumOfSlots (flow, bytes) slots. A packet
+  ///always takes its slot in the first stage, evicting the resident flow,
+  ///which is carried down the pipe and swapped with any smaller resident.
+  ///What leaves the last stage is dropped, so large flows stay.
+  class HashPipeProbe : public HeavyHitterProbe
+  {
+  public:
+    HashPipeProbe ();
+    virtual ~HashPipeProbe ();
+    static TypeId GetTypeId (void);
+
+  public:
+    void ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash);
+
+    uint64_t Estimate (const FlowField& flow, uint64_t hash) const;
+    uint64_t GetMemoryBytes () const;
+
+  protected:
+    virtual void NotifyConstructionCompleted (void);
+    virtual void GetCandidates (std::vector<HeavyHitter>& candidates) const;
+    virtual void ClearSketch ();
+
+  private:
+    uint32_t m_numStages; //Attribute
+    uint32_t m_numSlots;  //Attribute
+
+    std::vector<HeavyHitter> m_slots; //stage major, bytes 0 is an empty slot
+  };
+
+}
+
+#endif
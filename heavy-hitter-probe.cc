@@ -0,0 +1,184 @@
+#include "heavy-hitter-probe.h"
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("HeavyHitterProbe");
+  NS_OBJECT_ENSURE_REGISTERED(HeavyHitterProbe);
+
+  static bool
+  MoreBytes (const HeavyHitter& lhs, const HeavyHitter& rhs)
+  {
+    return lhs.bytes > rhs.bytes;
+  }
+
+  TypeId
+  HeavyHitterProbe::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::HeavyHitterProbe")
+      .SetParent<NeoProbe> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddAttribute("TopK",
+		    "The num of heavy hitters reported per epoch",
+		    UintegerValue(10),
+		    MakeUintegerAccessor(&HeavyHitterProbe::m_topK),
+		    MakeUintegerChecker<uint32_t>(1));
+
+    return tid;
+  }
+
+  HeavyHitterProbe::HeavyHitterProbe ()
+  {
+  }
+
+  HeavyHitterProbe::~HeavyHitterProbe ()
+  {
+  }
+
+  void
+  HeavyHitterProbe::Offer (const FlowField& flow, uint64_t hash, uint64_t bytes)
+  {
+    //TopK is small, a scan for the flow and the smallest candidate is enough
+    uint32_t iMin = 0;
+    for (uint32_t i = 0; i < m_candidates.size(); ++i)
+      {
+	if (m_candidates[i].hash == hash && m_candidates[i].flow == flow)
+	  {
+	    m_candidates[i].bytes = bytes;
+	    return;
+	  }
+	if (m_candidates[i].bytes < m_candidates[iMin].bytes) iMin = i;
+      }
+
+    if (m_candidates.size() < m_topK)
+      {
+	m_candidates.push_back(HeavyHitter());
+	iMin = m_candidates.size() - 1;
+      }
+    else if (bytes <= m_candidates[iMin].bytes)
+      {
+	return;
+      }
+    m_candidates[iMin].flow  = flow;
+    m_candidates[iMin].hash  = hash;
+    m_candidates[iMin].bytes = bytes;
+  }
+
+  void
+  HeavyHitterProbe::GetCandidates (std::vector<HeavyHitter>& candidates) const
+  {
+    candidates = m_candidates;
+  }
+
+  const std::vector<HeavyHitter>&
+  HeavyHitterProbe::GetTopK () const
+  {
+    return m_topKFlows;
+  }
+
+  void
+  HeavyHitterProbe::DoRollOver ()
+  {
+    //The real flow stats are frozen already, the sketch still holds the epoch
+    EpochStats stats;
+    Evaluate(GetEpochFlowStats(), m_topKFlows, stats);
+    m_epochStats.push_back(stats);
+    ClearSketch();
+    m_candidates.clear();
+  }
+
+  void
+  HeavyHitterProbe::Evaluate (const FlowStatContainer& real, std::vector<HeavyHitter>& topK,
+			      EpochStats& stats) const
+  {
+    GetCandidates(topK);
+    uint32_t k = std::min<uint32_t>(m_topK, topK.size());
+    std::partial_sort(topK.begin(), topK.begin() + k, topK.end(), MoreBytes);
+    topK.resize(k);
+
+    std::vector<HeavyHitter> realTopK;
+    realTopK.reserve(real.size());
+    for (FlowStatContainerCI ci = real.cbegin(); ci != real.cend(); ++ci)
+      {
+	HeavyHitter hh;
+	hh.flow  = ci->first;
+	hh.hash  = FlowFieldHash(ci->first);
+	hh.bytes = ci->second.bytecnt;
+	realTopK.push_back(hh);
+      }
+    uint32_t kReal = std::min<uint32_t>(m_topK, realTopK.size());
+    std::partial_sort(realTopK.begin(), realTopK.begin() + kReal, realTopK.end(), MoreBytes);
+    realTopK.resize(kReal);
+
+    stats.epoch       = GetEpoch();
+    stats.realFlows   = real.size();
+    stats.precision   = 0.;
+    stats.avgRelError = 0.;
+    stats.avgAbsError = 0.;
+    for (uint32_t i = 0; i < kReal; ++i)
+      {
+	const HeavyHitter& hh = realTopK[i];
+	for (uint32_t j = 0; j < k; ++j)
+	  {
+	    if (topK[j].flow == hh.flow) { stats.precision += 1.; break; }
+	  }
+	double error = std::fabs((double)Estimate(hh.flow, hh.hash) - (double)hh.bytes);
+	stats.avgAbsError += error;
+	stats.avgRelError += hh.bytes ? error / hh.bytes : 0.;
+      }
+    if (kReal)
+      {
+	stats.precision   /= kReal;
+	stats.avgRelError /= kReal;
+	stats.avgAbsError /= kReal;
+      }
+
+    NS_LOG_DEBUG("Node " << GetNodeId() << " epoch " << stats.epoch << " memory " << GetMemoryBytes()
+		 << " precision " << stats.precision << " ARE " << stats.avgRelError);
+  }
+
+  void
+  HeavyHitterProbe::PrintMeasurementStats (std::string fileNameSuffix) const
+  {
+    std::stringstream ss;       ss << GetNodeId() << "-" << fileNameSuffix;
+    std::string       filename; ss >> filename;
+    std::ofstream     file (filename.c_str());
+    NS_ASSERT(file);
+
+    //The open epoch, partial or the whole run without epochs, is scored
+    //here; its top k is the last one then
+    std::vector<EpochStats>  epochStats = m_epochStats;
+    std::vector<HeavyHitter> topKFlows  = m_topKFlows;
+    if (!GetRealFlowStats().empty())
+      {
+	EpochStats stats;
+	Evaluate(GetRealFlowStats(), topKFlows, stats);
+	epochStats.push_back(stats);
+      }
+
+    file << GetInstanceTypeId().GetName() << " MemoryBytes " << GetMemoryBytes() << " TopK " << m_topK << std::endl;
+    for (uint32_t i = 0; i < epochStats.size(); ++i)
+      {
+	const EpochStats& stats = epochStats[i];
+	file << "Interval "     << stats.epoch
+	     << " MemoryBytes " << GetMemoryBytes()
+	     << " RealFlows "   << stats.realFlows
+	     << " Precision "   << stats.precision
+	     << " ARE "         << stats.avgRelError
+	     << " AAE "         << stats.avgAbsError << std::endl;
+      }
+    for (uint32_t i = 0; i < topKFlows.size(); ++i)
+      {
+	file << topKFlows[i].flow << " EstByteCnt " << topKFlows[i].bytes << std::endl;
+      }
+  }
+
+}
@@ -0,0 +1,78 @@
+#ifndef HEAVY_HITTER_PROBE_H
+#define HEAVY_HITTER_PROBE_H
+
+#include "neo-probe.h"
+
+#include <vector>
+
+namespace ns3
+{
+
+  ///A flow and its estimated byte count
+  struct HeavyHitter
+  {
+    FlowField flow;
+    uint64_t  hash;
+    uint64_t  bytes;
+
+    HeavyHitter ()
+      : hash(0), bytes(0)
+    {
+    }
+  };
+
+  ///Base of the fixed-memory heavy hitter sketches. At every epoch end the
+  ///sketch reports its TopK flows by bytes and is scored against the real
+  ///flow stats of the epoch, then cleared; the open epoch is scored when the
+  ///stats are printed. The report lines carry the sketch
+  ///memory, so runs with different sizes give memory-versus-error curves.
+  class HeavyHitterProbe : public NeoProbe
+  {
+  protected:
+    HeavyHitterProbe ();
+  public:
+    virtual ~HeavyHitterProbe ();
+    static TypeId GetTypeId (void);
+
+  public:
+    void PrintMeasurementStats (std::string fileNameSuffix) const;
+
+    ///Estimated bytes of a flow in the current epoch
+    virtual uint64_t Estimate (const FlowField& flow, uint64_t hash) const = 0;
+
+    ///Top k flows reported for the last epoch, largest first
+    const std::vector<HeavyHitter>& GetTopK () const;
+
+  protected:
+    ///Keep flow as a top k candidate if its estimate is large enough
+    void         Offer (const FlowField& flow, uint64_t hash, uint64_t bytes);
+    ///Flows the top k is chosen from, the Offer candidates by default
+    virtual void GetCandidates (std::vector<HeavyHitter>& candidates) const;
+    virtual void ClearSketch () = 0;
+
+    virtual void DoRollOver ();
+
+    uint32_t m_topK; //Attribute
+
+  private:
+    ///Per epoch accuracy against the real flow stats
+    struct EpochStats
+    {
+      uint32_t epoch;
+      uint64_t realFlows;
+      double   precision;   //reported top k flows in the real top k
+      double   avgRelError; //over the real top k flows
+      double   avgAbsError; //over the real top k flows
+    };
+
+    ///Top k of the sketch as it is, scored against real
+    void Evaluate (const FlowStatContainer& real, std::vector<HeavyHitter>& topK, EpochStats& stats) const;
+
+    std::vector<HeavyHitter> m_candidates;
+    std::vector<HeavyHitter> m_topKFlows;
+    std::vector<EpochStats>  m_epochStats;
+  };
+
+}
+
+#endif
@@ -0,0 +1,624 @@
+#include "neo-benchmark.h"
+#include "neo-flow-tag.h"
+#include "flowradar-decoder.h"
+#include "neo-flow-cdf.h"
+#include "neo-flow-generator.h"
+#include "fattree-network.h"
+
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/object-factory.h"
+#include "ns3/integer.h"
+#include "ns3/ipv4.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/ipv4-address-generator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("NeoBenchmark");
+  NS_OBJECT_ENSURE_REGISTERED(NeoBenchmark);
+
+  //Keeps the hash loops from being optimized away
+  static volatile uint64_t g_benchmarkSink;
+
+  static double
+  ElapsedNs (std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  //Resident set size, 0 without /proc
+  static uint64_t
+  ResidentBytes ()
+  {
+    std::ifstream statm ("/proc/self/statm");
+    uint64_t      size, resident;
+    if (!(statm >> size >> resident)) return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+  }
+
+  static std::vector<std::string>
+  SplitList (const std::string& list)
+  {
+    std::vector<std::string> items;
+    std::istringstream is(list);
+    std::string item;
+    while (std::getline(is, item, ','))
+      {
+	if (!item.empty()) items.push_back(item);
+      }
+    return items;
+  }
+
+  TypeId
+  NeoBenchmark::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::NeoBenchmark")
+      .SetParent<Object> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<NeoBenchmark> ()
+      .AddAttribute("NumOfFlows",
+		    "The num of distinct flows of a probe or hash stream",
+		    UintegerValue(10000),
+		    MakeUintegerAccessor(&NeoBenchmark::m_numFlows),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("NumOfPackets",
+		    "The num of packets of a probe stream, and of hashes per hash run",
+		    UintegerValue(1000000),
+		    MakeUintegerAccessor(&NeoBenchmark::m_numPackets),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("PacketSize",
+		    "The IPv4 payload bytes of every packet",
+		    UintegerValue(1000),
+		    MakeUintegerAccessor(&NeoBenchmark::m_packetSize),
+		    MakeUintegerChecker<uint32_t>(1, 65515))
+      .AddAttribute("ZipfExponent",
+		    "The exponent of the Zipf mix",
+		    DoubleValue(1.1),
+		    MakeDoubleAccessor(&NeoBenchmark::m_zipfExponent),
+		    MakeDoubleChecker<double>(0.))
+      .AddAttribute("Probes",
+		    "The comma separated probe TypeIds to benchmark",
+		    StringValue("ns3::FlowRadarProbe,ns3::FlowMapProbe,ns3::CountMinProbe,"
+				"ns3::CountSketchProbe,ns3::HashPipeProbe,ns3::SampledFlowProbe"),
+		    MakeStringAccessor(&NeoBenchmark::m_probes),
+		    MakeStringChecker())
+      .AddAttribute("NumOfDecodeFlows",
+		    "The num of flows encoded at the switch a decode run decodes",
+		    UintegerValue(10000),
+		    MakeUintegerAccessor(&NeoBenchmark::m_numDecodeFlows),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("LoadFactors",
+		    "The comma separated flows per counting table cell of the decode runs",
+		    StringValue("0.2,0.4,0.6,0.7,0.8,0.9,1.0,1.2"),
+		    MakeStringAccessor(&NeoBenchmark::m_loadFactors),
+		    MakeStringChecker())
+      .AddAttribute("NumOfSetupFlows",
+		    "The num of flows, and of address lookups, of the flow setup run",
+		    UintegerValue(100000),
+		    MakeUintegerAccessor(&NeoBenchmark::m_numSetupFlows),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("SetupRunTime",
+		    "The simulated time the flow setup run goes on for with each FlowApplication, zero to skip",
+		    TimeValue(MilliSeconds(1)),
+		    MakeTimeAccessor(&NeoBenchmark::m_setupRunTime),
+		    MakeTimeChecker())
+      .AddAttribute("TopologySizes",
+		    "The comma separated FatTreeK of the topology setup runs, 0 for the two tier layout",
+		    StringValue("0,4,8,16"),
+		    MakeStringAccessor(&NeoBenchmark::m_topologySizes),
+		    MakeStringChecker())
+      .AddAttribute("Seed",
+		    "The seed of the flows and streams, the same for every suite",
+		    UintegerValue(1),
+		    MakeUintegerAccessor(&NeoBenchmark::m_seed),
+		    MakeUintegerChecker<uint32_t>())
+      .AddAttribute("Format",
+		    "CSV lines or a JSON array",
+		    EnumValue(NeoBenchmark::CSV),
+		    MakeEnumAccessor(&NeoBenchmark::m_format),
+		    MakeEnumChecker(NeoBenchmark::CSV,  "Csv",
+				    NeoBenchmark::JSON, "Json"))
+      .AddAttribute("FileName",
+		    "The file the results are written to, empty for the standard output",
+		    StringValue("neo-benchmark.csv"),
+		    MakeStringAccessor(&NeoBenchmark::m_fileName),
+		    MakeStringChecker());
+
+    return tid;
+  }
+
+  NeoBenchmark::NeoBenchmark ()
+  {
+  }
+
+  NeoBenchmark::~NeoBenchmark ()
+  {
+  }
+
+  const char*
+  NeoBenchmark::MixName (Mix mix)
+  {
+    switch (mix)
+      {
+      case UNIFORM_MIX:        return "uniform";
+      case ZIPF_MIX:           return "zipf";
+      case ELEPHANT_MOUSE_MIX: return "elephant-mouse";
+      }
+    return "";
+  }
+
+  void
+  NeoBenchmark::MakeFlows (uint32_t numFlows, std::vector<FlowField>& flows, std::vector<uint64_t>& hashes)
+  {
+    //Random 5-tuples, never the all zero empty key; duplicates are negligible
+    flows.resize(numFlows);
+    hashes.resize(numFlows);
+    for (uint32_t i = 0; i < numFlows; ++i)
+      {
+	uint64_t x = m_rng();
+	FlowField& f = flows[i];
+	f.ipv4srcip = (uint32_t)x | 1;
+	f.ipv4dstip = (uint32_t)(x >> 32);
+	x = m_rng();
+	f.srcport   = (uint16_t)x;
+	f.dstport   = (uint16_t)(x >> 16);
+	f.ipv4prot  = (x >> 32) & 1 ? 6 : 17;
+	hashes[i]   = FlowFieldHash(f);
+      }
+  }
+
+  void
+  NeoBenchmark::MakeStream (Mix mix, uint32_t numFlows, uint32_t numPackets, std::vector<uint32_t>& stream)
+  {
+    //Flows are random, so rank r may simply be flow r
+    std::vector<double> weights(numFlows, 1.);
+    uint32_t numElephants = std::max<uint32_t>(1, numFlows / 5);
+    for (uint32_t i = 0; i < numFlows; ++i)
+      {
+	if (mix == ZIPF_MIX) weights[i] = 1. / std::pow(i + 1., m_zipfExponent);
+	else if (mix == ELEPHANT_MOUSE_MIX)
+	  {
+	    weights[i] = i < numElephants ? 0.8 / numElephants : 0.2 / std::max<uint32_t>(1, numFlows - numElephants);
+	  }
+      }
+    NeoAliasTable table;
+    table.Build(weights);
+
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    stream.resize(numPackets);
+    for (uint32_t i = 0; i < numPackets; ++i) stream[i] = table.Sample(uniform(m_rng));
+  }
+
+  Ptr<NeoProbe>
+  NeoBenchmark::CreateProbe (const std::string& typeName) const
+  {
+    ObjectFactory factory;
+    factory.SetTypeId(typeName);
+    factory.Set("EpochTime", TimeValue(Seconds(0)));
+    //Only the data plane update is timed, not the ground truth kept for evaluation
+    factory.Set("KeepRealFlowStats", BooleanValue(false));
+    return factory.Create<NeoProbe>();
+  }
+
+  void
+  NeoBenchmark::AddResult (const std::string& suite, const std::string& name, const std::string& mix,
+			   uint32_t flows, double loadFactor, uint64_t ops, double ns,
+			   uint64_t memoryBytes, double successRate)
+  {
+    Result r;
+    r.suite       = suite;
+    r.name        = name;
+    r.mix         = mix;
+    r.flows       = flows;
+    r.loadFactor  = loadFactor;
+    r.ops         = ops;
+    r.nsPerOp     = ops ? ns / ops : 0.;
+    r.mpps        = ns > 0. ? ops * 1e3 / ns : 0.;
+    r.memoryBytes = memoryBytes;
+    r.successRate = successRate;
+    m_results.push_back(r);
+
+    NS_LOG_INFO(suite << " " << name << " " << mix << " flows " << flows << " ops " << ops
+		<< " ns/op " << r.nsPerOp << " Mpps " << r.mpps << " memory " << memoryBytes);
+  }
+
+  void
+  NeoBenchmark::RunProbes ()
+  {
+    m_rng.seed(m_seed);
+    std::vector<FlowField> flows;
+    std::vector<uint64_t>  hashes;
+    MakeFlows(m_numFlows, flows, hashes);
+
+    Ipv4Header ipHeader;
+    ipHeader.SetPayloadSize(m_packetSize);
+
+    std::vector<std::string> probes = SplitList(m_probes);
+    Mix mixes[3] = {UNIFORM_MIX, ZIPF_MIX, ELEPHANT_MOUSE_MIX};
+    for (uint32_t iM = 0; iM < 3; ++iM)
+      {
+	std::vector<uint32_t> stream;
+	MakeStream(mixes[iM], m_numFlows, m_numPackets, stream);
+
+	for (uint32_t iP = 0; iP < probes.size(); ++iP)
+	  {
+	    Ptr<NeoProbe> probe = CreateProbe(probes[iP]);
+
+	    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	    for (uint32_t i = 0; i < m_numPackets; ++i)
+	      {
+		uint32_t iF = stream[i];
+		probe->HandleForward(ipHeader, flows[iF], hashes[iF]);
+	      }
+	    double ns = ElapsedNs(start);
+
+	    AddResult("probe", probes[iP], MixName(mixes[iM]), m_numFlows, 0., m_numPackets, ns,
+		      probe->GetMemoryBytes(), -1.);
+	    probe->Dispose();
+	  }
+      }
+  }
+
+  void
+  NeoBenchmark::RunForward ()
+  {
+    m_rng.seed(m_seed);
+    std::vector<FlowField> flows;
+    std::vector<uint64_t>  hashes;
+    MakeFlows(m_numFlows, flows, hashes);
+
+    //One UDP or TCP packet per flow as the switch receives it: the IPv4
+    //header apart, the L4 header in the payload; a tagged copy for the tag path
+    std::vector<Ipv4Header>        ipHeaders(m_numFlows);
+    std::vector<Ptr<const Packet> > packets(m_numFlows), taggedPackets(m_numFlows);
+    for (uint32_t i = 0; i < m_numFlows; ++i)
+      {
+	const FlowField& f = flows[i];
+	Ptr<Packet> packet;
+	if (f.ipv4prot == TcpL4Protocol::PROT_NUMBER)
+	  {
+	    TcpHeader tcpHeader;
+	    tcpHeader.SetSourcePort(f.srcport);
+	    tcpHeader.SetDestinationPort(f.dstport);
+	    packet = Create<Packet>(std::max<uint32_t>(m_packetSize, 20) - 20);
+	    packet->AddHeader(tcpHeader);
+	  }
+	else
+	  {
+	    UdpHeader udpHeader;
+	    udpHeader.SetSourcePort(f.srcport);
+	    udpHeader.SetDestinationPort(f.dstport);
+	    packet = Create<Packet>(std::max<uint32_t>(m_packetSize, 8) - 8);
+	    packet->AddHeader(udpHeader);
+	  }
+	ipHeaders[i].SetSource(Ipv4Address(f.ipv4srcip));
+	ipHeaders[i].SetDestination(Ipv4Address(f.ipv4dstip));
+	ipHeaders[i].SetProtocol(f.ipv4prot);
+	ipHeaders[i].SetPayloadSize(packet->GetSize());
+	packets[i] = packet;
+
+	Ptr<Packet> tagged = packet->Copy();
+	tagged->AddPacketTag(NeoFlowTag(f, hashes[i]));
+	taggedPackets[i] = tagged;
+      }
+
+    std::vector<uint32_t> stream;
+    MakeStream(UNIFORM_MIX, m_numFlows, m_numPackets, stream);
+
+    const char* names[3] = {"Headers", "Peek", "FlowTag"};
+    for (uint32_t iV = 0; iV < 3; ++iV)
+      {
+	Ptr<NeoProbe> probe = CreateProbe("ns3::FlowRadarProbe");
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < m_numPackets; ++i)
+	  {
+	    uint32_t   iF = stream[i];
+	    FlowField  flow;
+	    uint64_t   hash;
+	    NeoFlowTag tag;
+	    if (iV == 0)
+	      {
+		flow.InitFromPacketHeaders(ipHeaders[iF], packets[iF]);
+		hash = FlowFieldHash(flow);
+	      }
+	    else if (iV == 1)
+	      {
+		flow.InitFromPacket(ipHeaders[iF], packets[iF]);
+		hash = FlowFieldHash(flow);
+	      }
+	    else
+	      {
+		taggedPackets[iF]->PeekPacketTag(tag);
+		tag.GetFlowField(ipHeaders[iF], flow);
+		hash = tag.GetFlowHash();
+	      }
+	    probe->HandleForward(ipHeaders[iF], flow, hash);
+	  }
+	double ns = ElapsedNs(start);
+
+	AddResult("forward", names[iV], MixName(UNIFORM_MIX), m_numFlows, 0., m_numPackets, ns,
+		  probe->GetMemoryBytes(), -1.);
+	probe->Dispose();
+      }
+  }
+
+  void
+  NeoBenchmark::RunHashes ()
+  {
+    m_rng.seed(m_seed);
+    std::vector<FlowField> flows;
+    std::vector<uint64_t>  hashes;
+    MakeFlows(m_numFlows, flows, hashes);
+
+    //Whole passes over the flows, at least NumOfPackets hashes
+    uint32_t numPasses = (m_numPackets + m_numFlows - 1) / m_numFlows;
+    uint64_t numHashes = (uint64_t)numPasses * m_numFlows;
+
+    //A probe takes its k table indices from one hash by double hashing
+    const uint32_t k = 4;
+    const uint32_t n = 1 << 16;
+
+    uint64_t sink = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t iP = 0; iP < numPasses; ++iP)
+      {
+	for (uint32_t i = 0; i < m_numFlows; ++i) sink ^= FlowFieldHash(flows[i], iP);
+      }
+    AddResult("hash", "FlowFieldHash", "", m_numFlows, 0., numHashes, ElapsedNs(start), 0, -1.);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t iP = 0; iP < numPasses; ++iP)
+      {
+	for (uint32_t i = 0; i < m_numFlows; ++i)
+	  {
+	    uint64_t hash = FlowFieldHash(flows[i], iP);
+	    for (uint32_t j = 0; j < k; ++j) sink += FlowHashIndex(hash, j, n);
+	  }
+      }
+    AddResult("hash", "FlowHashIndex/k4", "", m_numFlows, 0., numHashes * k, ElapsedNs(start), 0, -1.);
+    g_benchmarkSink = sink;
+  }
+
+  void
+  NeoBenchmark::RunDecoder ()
+  {
+    m_rng.seed(m_seed);
+    std::vector<FlowField> flows;
+    std::vector<uint64_t>  hashes;
+    MakeFlows(m_numDecodeFlows, flows, hashes);
+
+    //Every flow sends at least one packet, then 10 per flow on average as elephants and mice
+    std::vector<uint32_t> stream;
+    MakeStream(ELEPHANT_MOUSE_MIX, m_numDecodeFlows, m_numDecodeFlows * 9, stream);
+    for (uint32_t i = 0; i < m_numDecodeFlows; ++i) stream.push_back(i);
+
+    Ipv4Header ipHeader;
+    ipHeader.SetPayloadSize(m_packetSize);
+
+    std::vector<std::string> loadFactors = SplitList(m_loadFactors);
+    for (uint32_t iL = 0; iL < loadFactors.size(); ++iL)
+      {
+	double loadFactor = std::atof(loadFactors[iL].c_str());
+	NS_ASSERT_MSG(loadFactor > 0., "Bad load factor " << loadFactors[iL]);
+
+	//16 filter bits per flow keep filter false positives out of the decode rate
+	ObjectFactory factory;
+	factory.SetTypeId("ns3::FlowRadarProbe");
+	factory.Set("EpochTime", TimeValue(Seconds(0)));
+	factory.Set("ExpectedFlowCount", UintegerValue(m_numDecodeFlows));
+	factory.Set("NumOfCells", UintegerValue((uint32_t)std::max(1., std::ceil(m_numDecodeFlows / loadFactor))));
+	factory.Set("NumOfFilterBits", UintegerValue(std::max<uint32_t>(64, m_numDecodeFlows * 16)));
+	Ptr<FlowRadarProbe> probe = factory.Create<FlowRadarProbe>();
+
+	Ptr<FlowRadarDecoder> decoder = CreateObject<FlowRadarDecoder>();
+	decoder->AddProbe(probe);
+
+	for (uint32_t i = 0; i < stream.size(); ++i)
+	  {
+	    uint32_t iF = stream[i];
+	    probe->HandleForward(ipHeader, flows[iF], hashes[iF]);
+	  }
+
+	//The rollover decodes the epoch through EpochEnd
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	probe->RollOver();
+	double ns = ElapsedNs(start);
+
+	const FlowRadarDecoder::IntervalStats& stats = decoder->GetIntervalStats().back();
+	AddResult("decode", "FlowRadarDecoder", MixName(ELEPHANT_MOUSE_MIX), stats.realFlows, loadFactor,
+		  stats.realFlows, ns, probe->GetMemoryBytes(),
+		  stats.realFlows ? (double)stats.correctFlows / stats.realFlows : 0.);
+	decoder->Dispose();
+	probe->Dispose();
+      }
+  }
+
+  void
+  NeoBenchmark::RunFlowSetup ()
+  {
+    m_rng.seed(m_seed);
+    const NeoFlowGenerator::FlowApplication flowApps[2] = {NeoFlowGenerator::ONOFF_APPLICATION,
+							   NeoFlowGenerator::NEO_FLOW_SOURCE};
+    const char*                             names[2]    = {"OnOffApplication", "NeoFlowSource"};
+    for (uint32_t iA = 0; iA < 2; ++iA)
+      {
+	//A fresh network per FlowApplication, the other's apps gone
+	Simulator::Destroy();
+	Ipv4AddressGenerator::Reset();
+	Ptr<FatTreeNetwork> network = CreateObject<FatTreeNetwork>();
+	network->Initialize();
+	Ptr<const NeoTopologyIndex> topology = network->GetTopologyIndex();
+	if (iA == 0) RunAddressLookups(topology);
+
+	//Every switch sees NumOfExpectedFlowsPerSwtch flows, all pods together (pods - 1) times that;
+	//a single pod has no inter-pod flows and sets up about that many
+	int32_t numPodFactor = std::max<int32_t>(topology->GetNumPod() - 1, 1);
+	Ptr<NeoFlowGenerator> generator = CreateObject<NeoFlowGenerator>();
+	generator->SetAttribute("NumOfExpectedFlowsPerSwtch",
+				IntegerValue(m_numSetupFlows / numPodFactor + 1));
+	generator->SetAttribute("FlowApplication", EnumValue(flowApps[iA]));
+	uint64_t rss = ResidentBytes();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	generator->Initialize(topology);
+	generator->SetupApplications();
+	double   ns       = ElapsedNs(start);
+	uint64_t numFlows = generator->GetNumFlows();
+	uint64_t rssAfter = ResidentBytes();
+	AddResult("setup", names[iA], "", numFlows, 0., numFlows, ns, rssAfter > rss ? rssAfter - rss : 0, -1.);
+
+	//The flows' first SetupRunTime of simulation, no probes installed
+	if (m_setupRunTime.IsZero()) continue;
+	Simulator::Stop(m_setupRunTime);
+	start = std::chrono::steady_clock::now();
+	Simulator::Run();
+	ns = ElapsedNs(start);
+	rss = ResidentBytes();
+	AddResult("setup", std::string(names[iA]) + "/run", "", numFlows, 0., numFlows, ns,
+		  rss > rssAfter ? rss - rssAfter : 0, -1.);
+      }
+    Simulator::Destroy();
+    Ipv4AddressGenerator::Reset();
+  }
+
+  void
+  NeoBenchmark::RunAddressLookups (Ptr<const NeoTopologyIndex> topology)
+  {
+    //The address of a flow end, looked up through the Ipv4 aggregate or the index
+    std::vector<uint32_t> hosts(m_numSetupFlows), addrIdx(m_numSetupFlows);
+    for (uint32_t i = 0; i < m_numSetupFlows; ++i)
+      {
+	hosts[i]   = m_rng() % topology->GetNumHosts();
+	addrIdx[i] = m_rng() % topology->GetNumAddrPerHost();
+      }
+
+    uint64_t sink = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < m_numSetupFlows; ++i)
+      {
+	Ptr<Node> node = topology->GetHost(hosts[i]);
+	sink ^= node->GetObject<Ipv4>()->GetAddress(1, addrIdx[i]).GetLocal().Get();
+      }
+    AddResult("setup", "Ipv4Lookup", "", m_numSetupFlows, 0., m_numSetupFlows, ElapsedNs(start), 0, -1.);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < m_numSetupFlows; ++i)
+      {
+	sink ^= topology->GetAddress(hosts[i], addrIdx[i]).Get();
+      }
+    AddResult("setup", "TopologyIndex", "", m_numSetupFlows, 0., m_numSetupFlows, ElapsedNs(start),
+	      topology->GetMemoryBytes(), -1.);
+    g_benchmarkSink = sink;
+  }
+
+  void
+  NeoBenchmark::RunTopologySetup ()
+  {
+    std::vector<std::string> sizes = SplitList(m_topologySizes);
+    const FatTreeNetwork::RoutingMode modes[2] = {FatTreeNetwork::GLOBAL_ROUTING, FatTreeNetwork::FATTREE_ROUTING};
+    const char*                       names[2] = {"Global", "FatTree"};
+    for (uint32_t iS = 0; iS < sizes.size(); ++iS)
+      {
+	int32_t     k      = std::atoi(sizes[iS].c_str());
+	std::string layout = k > 0 ? "k" + sizes[iS] : "two-tier";
+	for (uint32_t iM = 0; iM < 2; ++iM)
+	  {
+	    //Every run starts from an empty node list and address pool
+	    Simulator::Destroy();
+	    Ipv4AddressGenerator::Reset();
+
+	    Ptr<FatTreeNetwork> network = CreateObject<FatTreeNetwork>();
+	    network->SetAttribute("FatTreeK", IntegerValue(k));
+	    network->SetAttribute("Routing", EnumValue(modes[iM]));
+	    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	    network->Initialize();
+	    double ns = ElapsedNs(start);
+	    AddResult("topology", names[iM], layout, network->GetTopologyIndex()->GetNumHosts(), 0., 1, ns, 0, -1.);
+	  }
+      }
+    Simulator::Destroy();
+    Ipv4AddressGenerator::Reset();
+  }
+
+  void
+  NeoBenchmark::Run ()
+  {
+    m_results.clear();
+    RunProbes();
+    RunForward();
+    RunHashes();
+    RunDecoder();
+    RunFlowSetup();
+    RunTopologySetup();
+    Write();
+  }
+
+  const std::vector<NeoBenchmark::Result>&
+  NeoBenchmark::GetResults () const
+  {
+    return m_results;
+  }
+
+  void
+  NeoBenchmark::Write (std::ostream& os) const
+  {
+    if (m_format == CSV)
+      {
+	os << "suite,name,mix,flows,load_factor,ops,ns_per_op,mpps,memory_bytes,success_rate" << std::endl;
+	for (uint32_t i = 0; i < m_results.size(); ++i)
+	  {
+	    const Result& r = m_results[i];
+	    os << r.suite << "," << r.name << "," << r.mix << "," << r.flows << "," << r.loadFactor << ","
+	       << r.ops << "," << r.nsPerOp << "," << r.mpps << "," << r.memoryBytes << "," << r.successRate
+	       << std::endl;
+	  }
+	return;
+      }
+
+    os << "[" << std::endl;
+    for (uint32_t i = 0; i < m_results.size(); ++i)
+      {
+	const Result& r = m_results[i];
+	os << "  {\"suite\": \"" << r.suite << "\", \"name\": \"" << r.name << "\", \"mix\": \"" << r.mix << "\""
+	   << ", \"flows\": "        << r.flows
+	   << ", \"load_factor\": "  << r.loadFactor
+	   << ", \"ops\": "          << r.ops
+	   << ", \"ns_per_op\": "    << r.nsPerOp
+	   << ", \"mpps\": "         << r.mpps
+	   << ", \"memory_bytes\": " << r.memoryBytes
+	   << ", \"success_rate\": " << r.successRate << "}"
+	   << (i + 1 < m_results.size() ? "," : "") << std::endl;
+      }
+    os << "]" << std::endl;
+  }
+
+  void
+  NeoBenchmark::Write () const
+  {
+    if (m_fileName.empty())
+      {
+	Write(std::cout);
+	return;
+      }
+    std::ofstream file (m_fileName.c_str());
+    NS_ASSERT_MSG(file, "Cannot open " << m_fileName);
+    Write(file);
+  }
+
+}
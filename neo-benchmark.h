@@ -0,0 +1,125 @@
+#ifndef NEO_BENCHMARK_H
+#define NEO_BENCHMARK_H
+
+#include "ns3/object.h"
+
+#include "neo-probe.h"
+#include "neo-topology-index.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+  /*Microbenchmarks of the measurement path without a network or a simulation
+   *run: synthetic FlowField streams are fed straight into the probes'
+   *ForwardLogger, the flow hashes and the FlowRadar decoder; real packets
+   *go through the flow extraction of the forward hook; network and flow
+   *setup are timed without running the simulation. A run is
+   *
+   *  CreateObject<NeoBenchmark> ()->Run ();
+   *
+   *from any program linked with the module; examples/neo-benchmark.cc runs
+   *chosen suites from the command line. Probe sizes are their attribute
+   *defaults, set them with Config::SetDefault before. Results go to FileName
+   *as one CSV line or JSON object per measurement, so runs of different
+   *commits can be compared.
+   */
+  class NeoBenchmark : public Object
+  {
+  public:
+    enum Format
+    {
+      CSV,
+      JSON
+    };
+
+    ///How the packets of a stream are spread over its flows
+    enum Mix
+    {
+      UNIFORM_MIX,
+      ZIPF_MIX,           //flow of rank r gets 1 / r^ZipfExponent of the packets
+      ELEPHANT_MOUSE_MIX  //20% elephant flows get 80% of the packets
+    };
+
+    struct Result
+    {
+      std::string suite;       //probe, forward, hash, decode, setup or topology
+      std::string name;        //probe TypeId, hash function, decoder or routing
+      std::string mix;         //or the topology layout
+      uint32_t    flows;       //or the hosts of a topology
+      double      loadFactor;  //flows per counting table cell, decode only
+      uint64_t    ops;         //packets, hashes or flows decoded
+      double      nsPerOp;
+      double      mpps;        //million ops per second
+      uint64_t    memoryBytes;
+      double      successRate; //correctly decoded flows, -1 if not decoding
+    };
+
+    static TypeId GetTypeId (void);
+
+    NeoBenchmark ();
+    virtual ~NeoBenchmark ();
+
+    ///Every probe of Probes with every mix
+    void RunProbes ();
+    ///Flow extraction and hashing of real packets as in the UnicastForward
+    ///hook, L4 headers deserialized against the port peek and the flow tag,
+    ///each followed by a FlowRadarProbe update
+    void RunForward ();
+    ///FlowFieldHash one flow at a time, and with the k FlowHashIndex indices a probe takes
+    void RunHashes ();
+    ///Decode success and time of one FlowRadar switch at every LoadFactors
+    void RunDecoder ();
+    ///Host address lookups, then NeoFlowGenerator flow setup of
+    ///NumOfSetupFlows flows and SetupRunTime of simulation, with each
+    ///FlowApplication on a FatTreeNetwork of its default attributes. Memory
+    ///is the growth of the resident set.
+    void RunFlowSetup ();
+    ///FatTreeNetwork::Initialize of every TopologySizes layout with global
+    ///and with fat-tree routing
+    void RunTopologySetup ();
+    ///All suites, then Write
+    void Run ();
+
+    const std::vector<Result>& GetResults () const;
+    void Write (std::ostream& os) const;
+    ///To FileName, or to std::cout if it is empty
+    void Write () const;
+
+    static const char* MixName (Mix mix);
+
+  private:
+    void MakeFlows (uint32_t numFlows, std::vector<FlowField>& flows, std::vector<uint64_t>& hashes);
+    ///Flow index of each packet
+    void MakeStream (Mix mix, uint32_t numFlows, uint32_t numPackets, std::vector<uint32_t>& stream);
+    Ptr<NeoProbe> CreateProbe (const std::string& typeName) const;
+    void RunAddressLookups (Ptr<const NeoTopologyIndex> topology);
+    void AddResult (const std::string& suite, const std::string& name, const std::string& mix,
+		    uint32_t flows, double loadFactor, uint64_t ops, double ns,
+		    uint64_t memoryBytes, double successRate);
+
+    uint32_t    m_numFlows;      //Attribute
+    uint32_t    m_numPackets;    //Attribute
+    uint32_t    m_packetSize;    //Attribute
+    double      m_zipfExponent;  //Attribute
+    std::string m_probes;        //Attribute
+    uint32_t    m_numDecodeFlows; //Attribute
+    std::string m_loadFactors;   //Attribute
+    uint32_t    m_numSetupFlows; //Attribute
+    Time        m_setupRunTime;  //Attribute
+    std::string m_topologySizes; //Attribute
+    uint32_t    m_seed;          //Attribute
+    Format      m_format;        //Attribute
+    std::string m_fileName;      //Attribute
+
+    std::mt19937_64     m_rng;
+    std::vector<Result> m_results;
+  };
+
+}
+
+#endif
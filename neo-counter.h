@@ -0,0 +1,125 @@
+#ifndef NEO_COUNTER_H
+#define NEO_COUNTER_H
+
+#include "ns3/assert.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace ns3
+{
+
+  ///a + b held at the largest value instead of wrapping, unsigned T only
+  template <typename T>
+  inline T
+  SaturatingAdd (T a, T b)
+  {
+    T sum = a + b;
+    return sum | -(T)(sum < a);
+  }
+
+  ///Value <-> raw bits of a packed counter, and the saturation at its range
+  template <typename T> struct PackedCounterTraits;
+
+  template <>
+  struct PackedCounterTraits<uint64_t>
+  {
+    static uint64_t Decode (uint64_t raw, uint32_t /*bits*/) { return raw; }
+    static uint64_t Encode (uint64_t value, uint64_t mask) { return value > mask ? mask : value; }
+  };
+
+  template <>
+  struct PackedCounterTraits<int64_t>
+  {
+    static int64_t Decode (uint64_t raw, uint32_t bits)
+    {
+      return (int64_t)(raw << (64 - bits)) >> (64 - bits);
+    }
+    static uint64_t Encode (int64_t value, uint64_t mask)
+    {
+      int64_t max = mask >> 1;
+      value = value > max ? max : value;
+      value = value < -max - 1 ? -max - 1 : value;
+      return (uint64_t)value & mask;
+    }
+  };
+
+  /*Counters of 1 to 57 bits packed back to back in 64-bit words, so a sketch
+   *takes the memory a switch would give it in SRAM. T is uint64_t for counters
+   *held at [0, 2^bits - 1] or int64_t for two's complement counters held at
+   *[-2^(bits-1), 2^(bits-1) - 1]. A counter is read and written through the
+   *unaligned 64 bits from its first byte, which hold it whole up to 57 bits,
+   *so no branch on whether it crosses a word. Little endian hosts only.
+   */
+  template <typename T>
+  class PackedCounterArray
+  {
+  public:
+    static const uint32_t MAX_BITS = 57;
+
+    PackedCounterArray ()
+      : m_size(0), m_bits(0), m_mask(0)
+    {
+    }
+
+    void Assign (uint32_t size, uint32_t bits)
+    {
+      NS_ASSERT_MSG(bits >= 1 && bits <= MAX_BITS, "Counters take 1 to " << MAX_BITS << " bits");
+      m_size = size;
+      m_bits = bits;
+      m_mask = ((uint64_t)1 << bits) - 1;
+      //One spare word keeps the window of the last counter inside
+      m_words.assign(((uint64_t)size * bits + 63) / 64 + 1, 0);
+    }
+
+    void Clear ()
+    {
+      std::fill(m_words.begin(), m_words.end(), 0);
+    }
+
+    uint32_t GetSize () const { return m_size; }
+    uint32_t GetBits () const { return m_bits; }
+    ///The bytes the counters take, without the spare word
+    uint64_t GetMemoryBytes () const { return ((uint64_t)m_size * m_bits + 7) / 8; }
+
+    T Get (uint32_t i) const
+    {
+      uint64_t bit = (uint64_t)i * m_bits;
+      return PackedCounterTraits<T>::Decode((Load(bit >> 3) >> (bit & 7)) & m_mask, m_bits);
+    }
+
+    ///Adds v held at the counter's range, returns the new value
+    T Add (uint32_t i, T v)
+    {
+      uint64_t bit   = (uint64_t)i * m_bits;
+      uint64_t shift = bit & 7;
+      uint64_t word  = Load(bit >> 3);
+      T        value = PackedCounterTraits<T>::Decode((word >> shift) & m_mask, m_bits) + v;
+      uint64_t raw   = PackedCounterTraits<T>::Encode(value, m_mask);
+      Store(bit >> 3, (word & ~(m_mask << shift)) | (raw << shift));
+      return PackedCounterTraits<T>::Decode(raw, m_bits);
+    }
+
+  private:
+    uint64_t Load (uint64_t byte) const
+    {
+      uint64_t word;
+      std::memcpy(&word, reinterpret_cast<const char*>(&m_words[0]) + byte, sizeof(word));
+      return word;
+    }
+    void Store (uint64_t byte, uint64_t word)
+    {
+      std::memcpy(reinterpret_cast<char*>(&m_words[0]) + byte, &word, sizeof(word));
+    }
+
+    uint32_t              m_size;
+    uint32_t              m_bits;
+    uint64_t              m_mask;
+    std::vector<uint64_t> m_words;
+  };
+
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include "neo-flow-cdf.h"
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("NeoFlowCdf");
+
+  void
+  NeoAliasTable::Build (const std::vector<double>& weights)
+  {
+    uint32_t n = weights.size();
+    NS_ASSERT_MSG(n > 0, "No weights");
+
+    double sum = 0.;
+    for (uint32_t i = 0; i < n; ++i) sum += weights[i];
+    NS_ASSERT_MSG(sum > 0., "Weights sum to 0");
+
+    //Scale the weights to mean 1, then pair each bucket below 1 with one above
+    m_prob.resize(n);
+    m_alias.resize(n);
+    std::vector<uint32_t> small, large;
+    for (uint32_t i = 0; i < n; ++i)
+      {
+	m_prob[i]  = weights[i] * n / sum;
+	m_alias[i] = i;
+	if (m_prob[i] < 1.) small.push_back(i);
+	else                large.push_back(i);
+      }
+    while (!small.empty() && !large.empty())
+      {
+	uint32_t s = small.back(); small.pop_back();
+	uint32_t l = large.back();
+	m_alias[s]  = l;
+	m_prob[l]  -= 1. - m_prob[s];
+	if (m_prob[l] < 1.)
+	  {
+	    large.pop_back();
+	    small.push_back(l);
+	  }
+      }
+    //Left overs are 1 up to rounding
+    for (uint32_t i = 0; i < small.size(); ++i) m_prob[small[i]] = 1.;
+    for (uint32_t i = 0; i < large.size(); ++i) m_prob[large[i]] = 1.;
+  }
+
+  uint32_t
+  NeoAliasTable::Sample (double u) const
+  {
+    double   x = u * m_prob.size();
+    uint32_t i = x;
+    if (i >= m_prob.size()) i = m_prob.size() - 1;
+    return (x - i < m_prob[i]) ? i : m_alias[i];
+  }
+
+  NeoEmpiricalCdf::NeoEmpiricalCdf ()
+    : m_mean(0.)
+  {
+  }
+
+  void
+  NeoEmpiricalCdf::Load (const std::string& fileName, double scale)
+  {
+    std::ifstream file(fileName.c_str());
+    NS_ASSERT_MSG(file, "Cannot open " << fileName);
+
+    std::vector<double> values, cdfs;
+    std::string line;
+    while (std::getline(file, line))
+      {
+	line = line.substr(0, line.find('#'));
+	std::istringstream is(line);
+	std::vector<double> columns;
+	double x;
+	while (is >> x) columns.push_back(x);
+	if (columns.empty()) continue;
+	NS_ASSERT_MSG(columns.size() >= 2, fileName << ": a point needs a value and a cdf");
+	NS_ASSERT_MSG(cdfs.empty() || (columns.front() * scale >= values.back() && columns.back() >= cdfs.back()),
+		      fileName << ": points must not decrease");
+	values.push_back(columns.front() * scale);
+	cdfs.push_back(columns.back());
+      }
+    NS_ASSERT_MSG(!cdfs.empty() && cdfs.back() > 0., fileName << " has no points");
+
+    //The first point's probability is a step of width 0 at its value
+    double total = cdfs.back();
+    m_values.assign(1, values[0]);
+    std::vector<double> weights;
+    double prev = 0.;
+    m_mean = 0.;
+    for (uint32_t i = 0; i < values.size(); ++i)
+      {
+	double p = (cdfs[i] - prev) / total;
+	weights.push_back(p);
+	m_mean += p * (m_values.back() + values[i]) / 2.;
+	m_values.push_back(values[i]);
+	prev = cdfs[i];
+      }
+    m_steps.Build(weights);
+
+    NS_LOG_DEBUG("Load " << fileName << " points " << values.size() << " mean " << m_mean);
+  }
+
+  double
+  NeoEmpiricalCdf::Sample (double u1, double u2) const
+  {
+    uint32_t i = m_steps.Sample(u1);
+    return m_values[i] + u2 * (m_values[i + 1] - m_values[i]);
+  }
+
+}
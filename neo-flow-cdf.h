@@ -0,0 +1,56 @@
+#ifndef NEO_FLOW_CDF_H
+#define NEO_FLOW_CDF_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+  ///Walker/Vose alias table: draws index i with probability weights[i] / sum
+  ///in constant time from one uniform number.
+  class NeoAliasTable
+  {
+  public:
+    void     Build (const std::vector<double>& weights);
+    ///u in [0, 1)
+    uint32_t Sample (double u) const;
+    uint32_t GetN () const { return m_prob.size(); }
+
+  private:
+    std::vector<double>   m_prob;  //chance to keep bucket i
+    std::vector<uint32_t> m_alias; //bucket taken otherwise
+  };
+
+  /*Empirical distribution read from a text CDF file, one point per line:
+   *
+   *  value [...] cdf
+   *
+   *the first column is the value, the last the cumulative probability in
+   *[0, 1] or in percent; '#' starts a comment. This covers the web search,
+   *data mining and Hadoop flow size files used in data center studies.
+   *Values are linearly interpolated between consecutive points; the step
+   *between them is drawn from an alias table.
+   */
+  class NeoEmpiricalCdf
+  {
+  public:
+    NeoEmpiricalCdf ();
+
+    ///Values are multiplied by scale, e.g. the packet size for CDFs in packets
+    void   Load (const std::string& fileName, double scale);
+    bool   IsEmpty () const { return m_values.empty(); }
+    double GetMean () const { return m_mean; }
+    ///u1, u2 independent uniform numbers in [0, 1)
+    double Sample (double u1, double u2) const;
+
+  private:
+    std::vector<double> m_values; //point values, step i runs from i to i + 1
+    NeoAliasTable       m_steps;
+    double              m_mean;
+  };
+
+}
+
+#endif
@@ -1,26 +1,31 @@
 #include "neo-flow-generator.h"
+#include "neo-flow-source.h"
+#include "neo-flow-sink.h"
 
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include "ns3/integer.h"
 #include "ns3/uinteger.h"
 #include "ns3/double.h"
-#include "ns3/node-container.h"
-#include "ns3/ipv4.h"
+#include "ns3/string.h"
+#include "ns3/enum.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/simulator.h"
+#include "ns3/system-wall-clock-ms.h"
 
+#include "ns3/udp-l4-protocol.h"
+#include "ns3/tcp-l4-protocol.h"
 #include "ns3/on-off-helper.h"
+#include "ns3/onoff-application.h"
+#include "ns3/bulk-send-helper.h"
 #include "ns3/packet-sink-helper.h"
 
-//Debug
-uint16_t port = 1;
+#include <algorithm>
+#include <cstring>
 
 namespace ns3
 {
-  //Helper functions declarations
-  Ipv4Address GetIpv4Addr(Ptr<Node> hstNode);
-
 }
 
 namespace ns3
@@ -29,6 +34,11 @@ namespace ns3
   NS_LOG_COMPONENT_DEFINE("NeoFlowGenerator");
   NS_OBJECT_ENSURE_REGISTERED(NeoFlowGenerator);
 
+  //Destination ports start from 1, source ports are taken from the ephemeral range
+  static const uint32_t NUM_DST_PORT   = 65535;
+  static const uint16_t SRC_PORT_FIRST = 49152;
+  static const uint32_t NUM_SRC_PORT   = 65536 - SRC_PORT_FIRST;
+
   TypeId NeoFlowGenerator::GetTypeId(void)
   {
     static TypeId tid = TypeId("ns3::NeoFlowGenerator")
@@ -54,25 +64,146 @@ namespace ns3
 		    "The origin simultion is divided into several consecutive virtual intervals",
 		    IntegerValue(1),
 		    MakeIntegerAccessor(&NeoFlowGenerator::m_numVirtualInterval),
-		    MakeIntegerChecker<int16_t>());
+		    MakeIntegerChecker<int32_t>(1))
+      .AddAttribute("RngStream",
+		    "The first random stream of the flow parameters, -1 for automatic; "
+		    "distributed runs take stream 0 then, so that all ranks draw the same flows",
+		    IntegerValue(-1),
+		    MakeIntegerAccessor(&NeoFlowGenerator::m_rngStream),
+		    MakeIntegerChecker<int64_t>(-1))
+      .AddAttribute("ScheduleMode",
+		    "Generate flows, also record them to ScheduleFile, or replay them from it",
+		    EnumValue(NeoFlowGenerator::GENERATE),
+		    MakeEnumAccessor(&NeoFlowGenerator::m_scheduleMode),
+		    MakeEnumChecker(NeoFlowGenerator::GENERATE, "Generate",
+				    NeoFlowGenerator::RECORD,   "Record",
+				    NeoFlowGenerator::REPLAY,   "Replay"))
+      .AddAttribute("ScheduleFile",
+		    "The binary flow schedule file recorded or replayed",
+		    StringValue("neo-flow-schedule.bin"),
+		    MakeStringAccessor(&NeoFlowGenerator::m_scheduleFile),
+		    MakeStringChecker())
+      .AddAttribute("FlowApplication",
+		    "Applications per flow, or one multiplexed source and sink per host",
+		    EnumValue(NeoFlowGenerator::NEO_FLOW_SOURCE),
+		    MakeEnumAccessor(&NeoFlowGenerator::m_flowApp),
+		    MakeEnumChecker(NeoFlowGenerator::ONOFF_APPLICATION, "OnOff",
+				    NeoFlowGenerator::NEO_FLOW_SOURCE,   "NeoFlowSource"))
+      .AddAttribute("Workload",
+		    "Elephant and mouse flows of exponential rates, or flow sizes from FlowSizeCdfFile",
+		    EnumValue(NeoFlowGenerator::EXPONENTIAL_WORKLOAD),
+		    MakeEnumAccessor(&NeoFlowGenerator::m_workload),
+		    MakeEnumChecker(NeoFlowGenerator::EXPONENTIAL_WORKLOAD, "Exponential",
+				    NeoFlowGenerator::TRACE_WORKLOAD,       "Trace"))
+      .AddAttribute("Transport",
+		    "UDP flows sent by FlowApplication, or TCP flows sent by BulkSendApplication",
+		    EnumValue(NeoFlowGenerator::UDP_TRANSPORT),
+		    MakeEnumAccessor(&NeoFlowGenerator::m_transport),
+		    MakeEnumChecker(NeoFlowGenerator::UDP_TRANSPORT, "Udp",
+				    NeoFlowGenerator::TCP_TRANSPORT, "Tcp"))
+      .AddAttribute("FlowSizeCdfFile",
+		    "The empirical flow size CDF of the trace workload, see NeoEmpiricalCdf",
+		    StringValue(""),
+		    MakeStringAccessor(&NeoFlowGenerator::m_flowSizeCdfFile),
+		    MakeStringChecker())
+      .AddAttribute("FlowSizeScale",
+		    "The bytes of one unit of FlowSizeCdfFile, e.g. 1460 for sizes in packets",
+		    DoubleValue(1.),
+		    MakeDoubleAccessor(&NeoFlowGenerator::m_flowSizeScale),
+		    MakeDoubleChecker<double>(0.))
+      .AddAttribute("InterArrivalCdfFile",
+		    "The empirical CDF of flow inter-arrival times in microseconds, "
+		    "empty for Poisson arrivals at Load",
+		    StringValue(""),
+		    MakeStringAccessor(&NeoFlowGenerator::m_interArrivalCdfFile),
+		    MakeStringChecker())
+      .AddAttribute("Load",
+		    "The fraction of DataRate a host offers with Poisson arrivals",
+		    DoubleValue(0.5),
+		    MakeDoubleAccessor(&NeoFlowGenerator::m_load),
+		    MakeDoubleChecker<double>(0., 1.))
+      .AddAttribute("FlowDataRate",
+		    "The data rate UDP flows of the trace workload send their size at",
+		    DataRateValue(DataRate("1Gbps")),
+		    MakeDataRateAccessor(&NeoFlowGenerator::m_flowBps),
+		    MakeDataRateChecker());
 
     return tid;
   }
 
   NeoFlowGenerator::NeoFlowGenerator()
+    : m_numFlows(0), m_hasNextRecord(false)
   {    
   }
 
   void
-  NeoFlowGenerator::Initialize(std::vector<NodeContainer> podHostNodes)
+  NeoFlowGenerator::DoDispose(void)
+  {
+    if(m_scheduleOut.is_open()) m_scheduleOut.close();
+    if(m_scheduleIn.is_open())  m_scheduleIn.close();
+    m_flowSources.clear();
+    m_flowSinks.clear();
+    m_topology = 0;
+    Object::DoDispose();
+  }
+
+  void
+  NeoFlowGenerator::Initialize(Ptr<const NeoTopologyIndex> topology)
   {
 
-    m_numPod        = podHostNodes.size();
-    m_numHostPerPod = podHostNodes[0].GetN();
-    m_podHostNodes  = podHostNodes;
+    m_topology       = topology;
+    m_numPod         = topology->GetNumPod();
+    m_numHostPerPod  = topology->GetNumHostPerPod();
+    m_numAddrPerHost = topology->GetNumAddrPerHost();
 
     SetupParameters();
+    OpenSchedule();
+
+  }
 
+  void
+  NeoFlowGenerator::OpenSchedule()
+  {
+    NeoFlowScheduleHeader header;
+    std::memset(&header, 0, sizeof(header));
+
+    //Distributed: all ranks draw the same flows, the first one records them
+    if(m_scheduleMode == RECORD && IsFirstSystem())
+      {
+	m_scheduleOut.open(m_scheduleFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	NS_ABORT_MSG_IF(!m_scheduleOut, "Cannot open " << m_scheduleFile);
+
+	std::memcpy(header.magic, NEO_FLOW_SCHEDULE_MAGIC, sizeof(header.magic));
+	header.version        = NEO_FLOW_SCHEDULE_VERSION;
+	header.numPod         = m_numPod;
+	header.numHostPerPod  = m_numHostPerPod;
+	header.numInterval    = m_numVirtualInterval;
+	header.numAddrPerHost = m_numAddrPerHost;
+	header.intervalTimeNs = m_intervalTime.GetNanoSeconds();
+	m_scheduleOut.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      }
+    else if(m_scheduleMode == REPLAY)
+      {
+	m_scheduleIn.open(m_scheduleFile.c_str(), std::ios::in | std::ios::binary);
+	NS_ABORT_MSG_IF(!m_scheduleIn, "Cannot open " << m_scheduleFile);
+
+	m_scheduleIn.read(reinterpret_cast<char*>(&header), sizeof(header));
+	NS_ABORT_MSG_IF(!m_scheduleIn || std::memcmp(header.magic, NEO_FLOW_SCHEDULE_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != NEO_FLOW_SCHEDULE_VERSION,
+			m_scheduleFile << " is not a version " << NEO_FLOW_SCHEDULE_VERSION << " flow schedule");
+	NS_ABORT_MSG_IF(header.numPod != m_numPod || header.numHostPerPod != m_numHostPerPod,
+			m_scheduleFile << " was recorded on " << header.numPod << " pods of "
+			<< header.numHostPerPod << " hosts");
+	NS_ABORT_MSG_IF(header.numAddrPerHost != m_numAddrPerHost,
+			m_scheduleFile << " was recorded with " << header.numAddrPerHost << " addresses per host");
+	//Flow times are relative to their interval and flows stop at its end
+	NS_ABORT_MSG_IF(header.intervalTimeNs != m_intervalTime.GetNanoSeconds(),
+			m_scheduleFile << " was recorded with IntervalTime " << NanoSeconds(header.intervalTimeNs));
+	NS_ABORT_MSG_IF(header.numInterval != (uint32_t)m_numVirtualInterval,
+			m_scheduleFile << " was recorded over " << header.numInterval << " VirtualInterval");
+	NS_LOG_DEBUG("Replay " << m_scheduleFile << " intervals " << header.numInterval);
+	m_hasNextRecord = false;
+      }
   }
 
   void 
@@ -80,14 +211,21 @@ namespace ns3
   {
     NS_LOG_DEBUG("===Setup flows's parameters===");
 
-    m_nextDstPort.resize(m_numPod);
-    for(int iPod = 0; iPod < m_numPod; ++iPod)
-      {
-	m_nextDstPort[iPod].resize(m_numHostPerPod, 1); //PORT MUST START FROM 1
-      }
+    int32_t numHosts = m_topology->GetNumHosts();
+    m_nextFlowId.assign(numHosts, 0);
+    m_flowSources.resize(numHosts);
+    m_flowSinks.resize(numHosts);
+
+    //OnOff flows take an ephemeral source port of their socket,
+    //only the destination address and port tell them apart
+    uint64_t maxFlowId = (uint64_t)NUM_DST_PORT * m_numAddrPerHost;
+    if(m_flowApp == NEO_FLOW_SOURCE) maxFlowId *= NUM_SRC_PORT;
+    m_maxFlowId = std::min<uint64_t>(maxFlowId, 0xffffffff);
 
     NS_LOG_DEBUG("Pods(n) :" << m_numPod);
     NS_LOG_DEBUG("Hosts per pod(n) : " << m_numHostPerPod);
+    NS_LOG_DEBUG("Addresses per host(n) : " << m_numAddrPerHost);
+    NS_LOG_DEBUG("Flows per destination host(max) : " << m_maxFlowId);
     NS_LOG_DEBUG("Expected number of flows per switch : " << m_numExpectedFlowsPerSwtch);
     NS_LOG_DEBUG("Total bps of all apps on a hst : " << m_bpsHst.GetBitRate());
     NS_LOG_DEBUG("Number of virtual intervals : " << m_numVirtualInterval);
@@ -151,13 +289,60 @@ namespace ns3
     m_mouseBps->SetAttribute("Mean", DoubleValue(bpsMeanMousePerFlow));
     m_mouseBps->SetAttribute("Bound", DoubleValue(bpsBoundMousePerFlow));
 
+    /*UDP flows send the PacketSize of the application they are set up with,
+     *as configured (Config::SetDefault) when the generator is initialized
+     */
+    TypeId appTid = m_flowApp == NEO_FLOW_SOURCE ? NeoFlowSource::GetTypeId() : OnOffApplication::GetTypeId();
+    TypeId::AttributeInformation pktSizeInfo;
+    NS_ABORT_MSG_IF(!appTid.LookupAttributeByName("PacketSize", &pktSizeInfo),
+		    appTid.GetName() << " has no PacketSize");
+    m_pktSize = DynamicCast<const UintegerValue>(pktSizeInfo.initialValue)->Get();
+    NS_LOG_DEBUG("Packet size of UDP flows : " << m_pktSize);
+
     /*Set minBps*/
-    m_minBps = DataRate(512 * 8 / m_intervalTime.GetSeconds());
+    m_minBps = DataRate(m_pktSize * 8 / m_intervalTime.GetSeconds());
     NS_LOG_DEBUG("Min bps of a flow : " << m_minBps.GetBitRate());
 
+    if(m_workload == TRACE_WORKLOAD)
+      {
+	NS_ASSERT_MSG(!m_flowSizeCdfFile.empty(), "The trace workload needs a FlowSizeCdfFile");
+	//A flow's destination is drawn from the other hosts
+	NS_ABORT_MSG_IF(numHosts < 2, "The trace workload needs at least 2 hosts");
+	m_flowSizeCdf.Load(m_flowSizeCdfFile, m_flowSizeScale);
+	if(!m_interArrivalCdfFile.empty()) m_interArrivalCdf.Load(m_interArrivalCdfFile, 1e-6);
+	else NS_ASSERT_MSG(m_load > 0., "Poisson arrivals need a Load above 0");
+	NS_LOG_DEBUG("Trace flow size : mean bytes " << m_flowSizeCdf.GetMean());
+      }
+    //Poisson arrivals offering Load of the host data rate
+    m_interArrival = CreateObject<ExponentialRandomVariable>();
+    m_interArrival->SetAttribute("Mean", DoubleValue(m_flowSizeCdf.IsEmpty() ? 1. :
+						     m_flowSizeCdf.GetMean() * 8 / (m_load * m_bpsHst.GetBitRate())));
+    m_uniform = CreateObject<UniformRandomVariable>();
+
+    //Automatic streams depend on the objects a rank created before
+    if(m_rngStream >= 0)
+      {
+	AssignStreams(m_rngStream);
+      }
+    else if(IsDistributed())
+      {
+	AssignStreams(0);
+      }
+
     return;
   }
 
+  int64_t
+  NeoFlowGenerator::AssignStreams(int64_t stream)
+  {
+    m_startTimeOffset->SetStream(stream);
+    m_elephantBps->SetStream(stream + 1);
+    m_mouseBps->SetStream(stream + 2);
+    m_interArrival->SetStream(stream + 3);
+    m_uniform->SetStream(stream + 4);
+    return 5;
+  }
+
   void 
   NeoFlowGenerator::SetupApplications()
   {
@@ -166,40 +351,47 @@ namespace ns3
     NS_LOG_DEBUG("Interval " << m_idxVirtualInterval);
     NS_LOG_DEBUG("Start From: " << Simulator::Now().GetMilliSeconds() << "ms");
 
+    SystemWallClockMs clock;
+    clock.Start();
+
     /**/
-    for(int iSrcPod = 0; iSrcPod < m_numPod; ++iSrcPod)
+    if(m_scheduleMode == REPLAY)
+      {
+	ReplayInterval();
+      }
+    else
       {
-	NS_LOG_DEBUG("Host in pod " << iSrcPod << " setting");
-	for(int iSrcHst = 0; iSrcHst < m_numHostPerPod; ++iSrcHst )
+	for(int iSrcPod = 0; iSrcPod < m_numPod; ++iSrcPod)
 	  {
-	    NS_LOG_DEBUG("Hst " << iSrcHst << " setting");
-
-	    SetupFlowsOriginFrom(iSrcPod, iSrcHst);
-	    //SetupTestFlowsOriginFrom(iSrcPod, iSrcHst)；
+	    NS_LOG_DEBUG("Host in pod " << iSrcPod << " setting");
+	    for(int iSrcHst = 0; iSrcHst < m_numHostPerPod; ++iSrcHst )
+	      {
+		NS_LOG_DEBUG("Hst " << iSrcHst << " setting");
+
+		if(m_workload == TRACE_WORKLOAD) SetupTraceFlowsOriginFrom(iSrcPod, iSrcHst);
+		else                             SetupFlowsOriginFrom(iSrcPod, iSrcHst);
+		//SetupTestFlowsOriginFrom(iSrcPod, iSrcHst)；
+	      }
 	  }
-	
       }
     
-    for(int iSrcPod = 0; iSrcPod < m_numPod; ++iSrcPod)
+    uint32_t numApps = 0;
+    for(int32_t iHost = 0; iHost < m_topology->GetNumHosts(); ++iHost)
       {
-	NS_LOG_DEBUG("Host in pod " << iSrcPod << " setting");
-	for(int iSrcHst = 0; iSrcHst < m_numHostPerPod; ++iSrcHst)
-	  {
-	    Ptr<Node> node = m_podHostNodes[iSrcPod].Get(iSrcHst);
-	    NS_LOG_DEBUG("Hst "<< iSrcHst << " apps num : " << node->GetNApplications());
-	  }
+	numApps += m_topology->GetHost(iHost)->GetNApplications();
       }
+    NS_LOG_INFO("Interval " << m_idxVirtualInterval << " setup " << clock.End() << "ms"
+		<< " flows " << m_numFlows << " apps " << numApps);
     
 
     /*
-    Ptr<Node> srcNode = m_podHostNodes[0].Get(0);
-    Ptr<Node> dstNode = m_podHostNodes[3].Get(0);
     uint64_t  bps = m_elephantBps->GetInteger();
-    SetupUDPFlow(srcNode, dstNode, bps, port++, Time(0.), m_intervalTime); 
+    SetupUDPFlow(m_topology->GetHostIndex(0, 0), m_topology->GetHostIndex(3, 0), bps,
+		 NextFlowId(3, 0), Time(0.), m_intervalTime); 
     */
 
-    //Setup next virtual interval simulation
-    /*
+    //Setup next virtual interval simulation,
+    //probes with EpochTime == IntervalTime measure each interval as one epoch
     ++m_idxVirtualInterval;
     if(m_idxVirtualInterval < m_numVirtualInterval)
       {
@@ -209,15 +401,91 @@ namespace ns3
     else
       {
 	NS_LOG_DEBUG("All flow generated");
+	if(m_scheduleOut.is_open()) m_scheduleOut.close();
+      }
+  }
+
+  /*Streams the records of the current interval, the first record of the
+   *next interval is kept for its turn.
+   */
+  void
+  NeoFlowGenerator::ReplayInterval()
+  {
+    uint32_t numFlows = 0;
+    for(;;)
+      {
+	if(!m_hasNextRecord)
+	  {
+	    m_scheduleIn.read(reinterpret_cast<char*>(&m_nextRecord), sizeof(m_nextRecord));
+	    NS_ABORT_MSG_IF(m_scheduleIn.gcount() != 0 && m_scheduleIn.gcount() != sizeof(m_nextRecord),
+			    m_scheduleFile << " ends in a truncated flow record");
+	    if(!m_scheduleIn) break;
+	    m_hasNextRecord = true;
+	    //Records are in interval order, a late one would hold back all after it
+	    NS_ABORT_MSG_IF(m_nextRecord.interval < (uint32_t)m_idxVirtualInterval
+			    || m_nextRecord.interval >= (uint32_t)m_numVirtualInterval,
+			    m_scheduleFile << " has a record of interval " << m_nextRecord.interval
+			    << " in interval " << m_idxVirtualInterval);
+	  }
+	if(m_nextRecord.interval != (uint32_t)m_idxVirtualInterval) break;
+	m_hasNextRecord = false;
+
+	const NeoFlowRecord& r = m_nextRecord;
+	NS_ABORT_MSG_IF(r.srcPod >= m_numPod || r.dstPod >= m_numPod
+			|| r.srcHst >= m_numHostPerPod || r.dstHst >= m_numHostPerPod,
+			m_scheduleFile << " has a bad flow record of pod " << r.srcPod << " host " << r.srcHst
+			<< " to pod " << r.dstPod << " host " << r.dstHst);
+	SetupFlow(r);
+	++numFlows;
+      }
+    NS_LOG_DEBUG("Replayed " << numFlows << " flows");
+  }
+
+  void
+  NeoFlowGenerator::AddFlow(int iSrcPod, int iSrcHst, int iDstPod, int iDstHst,
+			    uint64_t bps, uint64_t bytes, uint32_t flowId,
+			    const Time& startTime, const Time& endTime)
+  {
+    NeoFlowRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.interval = m_idxVirtualInterval;
+    r.srcPod   = iSrcPod;
+    r.srcHst   = iSrcHst;
+    r.dstPod   = iDstPod;
+    r.dstHst   = iDstHst;
+    r.prot     = (m_transport == TCP_TRANSPORT) ? TcpL4Protocol::PROT_NUMBER : UdpL4Protocol::PROT_NUMBER;
+    r.flowId   = flowId;
+    r.bps      = bps;
+    r.bytes    = bytes;
+    r.startNs  = startTime.GetNanoSeconds();
+    r.stopNs   = endTime.GetNanoSeconds();
+    if(m_scheduleOut.is_open()) m_scheduleOut.write(reinterpret_cast<const char*>(&r), sizeof(r));
+
+    SetupFlow(r);
+  }
+
+  void
+  NeoFlowGenerator::SetupFlow(const NeoFlowRecord& r)
+  {
+    int32_t iSrc = m_topology->GetHostIndex(r.srcPod, r.srcHst);
+    int32_t iDst = m_topology->GetHostIndex(r.dstPod, r.dstHst);
+    ++m_numFlows;
+    if(r.prot == TcpL4Protocol::PROT_NUMBER)
+      {
+	//Without a size, a TCP flow offers what its rate sends in its time
+	uint64_t bytes = r.bytes;
+	if(bytes == 0 && r.stopNs > r.startNs) bytes = r.bps * ((r.stopNs - r.startNs) * 1e-9) / 8;
+	SetupTCPFlow(iSrc, iDst, bytes, r.flowId, NanoSeconds(r.startNs), NanoSeconds(r.stopNs));
+      }
+    else
+      {
+	SetupUDPFlow(iSrc, iDst, r.bps, r.flowId, NanoSeconds(r.startNs), NanoSeconds(r.stopNs));
       }
-    */
-    ++m_idxVirtualInterval;
   }
 
   void
   NeoFlowGenerator::SetupFlowsOriginFrom(int iSrcPod, int iSrcHst)
   {
-    Ptr<Node> srcNode   = m_podHostNodes[iSrcPod].Get(iSrcHst);
     Time      startTime (MilliSeconds(0.0001));
     Time      endTime   = m_intervalTime;
 
@@ -233,12 +501,10 @@ namespace ns3
       {
 	int16_t iDstPod = startPodOffset + nextPod; 
 	int16_t iDstHst = nextHostInPod[nextPod];
-	int16_t port    = m_nextDstPort[iDstPod][iDstHst]++;
-	NS_ASSERT_MSG(port < 65535, "Port overflow");
+	uint32_t flowId = NextFlowId(iDstPod, iDstHst);
 
 	//Prepare flow parameters
-	Ptr<Node> dstNode = m_podHostNodes[iDstPod].Get(iDstHst);
-	NS_ASSERT_MSG(srcNode != dstNode, "Do not send to yourself");
+	NS_ASSERT_MSG(iSrcPod != iDstPod || iSrcHst != iDstHst, "Do not send to yourself");
 	uint64_t  bps = 0;
 	while(bps < m_minBps.GetBitRate())
 	  {
@@ -253,18 +519,18 @@ namespace ns3
 	  {
 	    NS_LOG_DEBUG("srcPod "   << iSrcPod << " srcHst " << iSrcHst 
 			 << " dstPod " << iDstPod << " dstHst " << iDstHst
-			 << " port "   << port << " bps " << bps
+			 << " flow "   << flowId << " bps " << bps
 			 << " " << (startTime + startOffset).GetMilliSeconds() 
 			 << " " << (endTime - endOffset).GetMilliSeconds());
 	  }
 	
 	NS_LOG_DEBUG("srcPod "   << iSrcPod << " srcHst " << iSrcHst 
 		     << " dstPod " << iDstPod << " dstHst " << iDstHst
-		     << " port "   << port << " bps " << bps
+		     << " flow "   << flowId << " bps " << bps
 		     << " " << (startTime + offset).GetMilliSeconds() 
 		     << " " << endTime.GetMilliSeconds());
 	*/
-	SetupUDPFlow(srcNode, dstNode, bps, port, startTime + startOffset, endTime - endOffset);
+	AddFlow(iSrcPod, iSrcHst, iDstPod, iDstHst, bps, 0, flowId, startTime + startOffset, endTime - endOffset);
 
 	//Update Pod Host index;
 	nextHostInPod[nextPod]++; 
@@ -288,12 +554,10 @@ namespace ns3
 	    nextHstInSrcPod %= m_numHostPerPod;
 	  }
 	
-	int16_t port = m_nextDstPort[iSrcPod][nextHstInSrcPod]++;
-	NS_ASSERT_MSG(port < 65535, "Port overflow");
+	uint32_t flowId = NextFlowId(iSrcPod, nextHstInSrcPod);
 
 	//Prepare flow parameters
-	Ptr<Node> dstNode = m_podHostNodes[iSrcPod].Get(nextHstInSrcPod);
-	NS_ASSERT_MSG(srcNode != dstNode, "Do not sent to yourself");
+	NS_ASSERT_MSG(iSrcHst != nextHstInSrcPod, "Do not sent to yourself");
 	uint64_t bps = 0;
 	while(bps < m_minBps.GetBitRate())
 	  {
@@ -307,7 +571,7 @@ namespace ns3
 	  {
 	    NS_LOG_DEBUG("srcPod "   << iSrcPod << " srcHst " << iSrcHst 
 			 << " dstPod " << iSrcPod << " dstHst " << nextHstInSrcPod
-			 << " port "   << port << " bps " << bps
+			 << " flow "   << flowId << " bps " << bps
 			 << " " << (startTime + startOffset).GetMilliSeconds() 
 			 << " " << (endTime - endOffset).GetMilliSeconds());
 	  }
@@ -315,11 +579,11 @@ namespace ns3
 	
 	NS_LOG_DEBUG("srcPod "   << iSrcPod << " srcHst " << iSrcHst 
 		     << " dstPod " << iSrcPod << " dstHst " << nextHstInSrcPod
-		     << " port "   << port << " bps " << bps
+		     << " flow "   << flowId << " bps " << bps
 		     << " " << (startTime + offset).GetMilliSeconds() 
 		     << " " << endTime.GetMilliSeconds());
 	*/
-	SetupUDPFlow(srcNode, dstNode, bps, port, startTime + startOffset, endTime - endOffset);
+	AddFlow(iSrcPod, iSrcHst, iSrcPod, nextHstInSrcPod, bps, 0, flowId, startTime + startOffset, endTime - endOffset);
 
 	//Update Host index
 	++nextHstInSrcPod;
@@ -327,7 +591,45 @@ namespace ns3
       }
   }
 
-  
+  /*Flows of one host in the trace workload: arrivals from InterArrivalCdfFile
+   *or Poisson, destinations uniform over the other hosts, sizes from
+   *FlowSizeCdfFile. UDP flows send their size at FlowDataRate, TCP flows
+   *send it as fast as TCP goes; both stop at the end of the interval.
+   */
+  void
+  NeoFlowGenerator::SetupTraceFlowsOriginFrom(int iSrcPod, int iSrcHst)
+  {
+    int32_t  numHst  = m_numPod * m_numHostPerPod;
+    int32_t  iSrc    = iSrcPod * m_numHostPerPod + iSrcHst;
+    uint64_t bps     = m_flowBps.GetBitRate();
+    Time     pktTime = Seconds(m_pktSize * 8. / bps);
+
+    if(numHst < 2) return;
+
+    Time startTime;
+    for(;;)
+      {
+	if(m_interArrivalCdf.IsEmpty()) startTime += Seconds(m_interArrival->GetValue());
+	else startTime += Seconds(m_interArrivalCdf.Sample(m_uniform->GetValue(), m_uniform->GetValue()));
+	if(startTime >= m_intervalTime) break;
+
+	int32_t iDst = m_uniform->GetInteger(0, numHst - 2);
+	if(iDst >= iSrc) ++iDst;
+	int16_t  iDstPod = iDst / m_numHostPerPod;
+	int16_t  iDstHst = iDst % m_numHostPerPod;
+	uint64_t bytes   = m_flowSizeCdf.Sample(m_uniform->GetValue(), m_uniform->GetValue());
+	if(bytes == 0) bytes = 1;
+
+	Time endTime = m_intervalTime;
+	if(m_transport == UDP_TRANSPORT)
+	  {
+	    //The last of its m_pktSize byte packets leaves numPkts packet times after the start
+	    uint64_t numPkts = (bytes + m_pktSize - 1) / m_pktSize;
+	    endTime = std::min(endTime, startTime + NanoSeconds(pktTime.GetNanoSeconds() * numPkts + 1));
+	  }
+	AddFlow(iSrcPod, iSrcHst, iDstPod, iDstHst, bps, bytes, NextFlowId(iDstPod, iDstHst), startTime, endTime);
+      }
+  }
 
   /*Send flow originated from one host, destinated to all other hosts
    *Use to test the network works correctly.
@@ -344,47 +646,151 @@ namespace ns3
 	  {
 	    if(iSrcHst == iDstHst && iSrcPod == iDstPod) continue;
 	    
-	    uint16_t port = m_nextDstPort[iDstPod][iDstHst]++; //Add 1 Each Time 
-	    NS_ASSERT_MSG(port < 65535, "Port overflow");
+	    uint32_t flowId = NextFlowId(iDstPod, iDstHst);
 	    
 	    bps += 100; 
 	    
-	    Ptr<Node> srcNode = m_podHostNodes[iSrcPod].Get(iSrcHst);
-	    Ptr<Node> dstNode = m_podHostNodes[iDstPod].Get(iDstHst);
-	    SetupUDPFlow(srcNode, dstNode, bps, port, Time(), Time());
+	    SetupUDPFlow(m_topology->GetHostIndex(iSrcPod, iSrcHst), m_topology->GetHostIndex(iDstPod, iDstHst),
+			 bps, flowId, Time(), Time());
 	  }
       } 
   }
 
 
   void
-  NeoFlowGenerator::SetupUDPFlow(Ptr<Node> srcNode, Ptr<Node> dstNode, 
-				 uint64_t bps, uint16_t port, 
+  NeoFlowGenerator::SetupUDPFlow(int32_t iSrc, int32_t iDst,
+				 uint64_t bps, uint32_t flowId, 
 				 const Time& startTime, const Time& endTime)
   {
+    NS_ASSERT_MSG(flowId < m_maxFlowId, "Flow id " << flowId << " out of range, add addresses per host");
+    uint32_t srcAddrIdx, dstAddrIdx;
+    uint16_t srcPort, dstPort;
+    GetFlowTuple(flowId, srcAddrIdx, dstAddrIdx, srcPort, dstPort);
+
+    if(m_flowApp == NEO_FLOW_SOURCE)
+      {
+	if(m_topology->IsLocal(iSrc))
+	  {
+	    GetFlowSource(iSrc)->AddFlow(m_topology->GetAddress(iSrc, srcAddrIdx), srcPort,
+					 m_topology->GetAddress(iDst, dstAddrIdx), dstPort,
+					 bps, startTime, endTime);
+	  }
+	if(m_topology->IsLocal(iDst)) GetFlowSink(iDst)->AddPort(dstPort, endTime);
+	return;
+      }
 
     ApplicationContainer apps;
     
-    Ipv4Address dstIpv4Addr = GetIpv4Addr(dstNode); 
-    OnOffHelper onOff("ns3::UdpSocketFactory",
-		      Address(InetSocketAddress(dstIpv4Addr, port)));
-    onOff.SetConstantRate(DataRate(bps));
-    //For debug
-    //onOff.SetAttribute("MaxBytes", UintegerValue(512));
-    apps.Add(onOff.Install(srcNode));
+    //Distributed: each rank installs the ends on its own nodes,
+    //the flow parameters were drawn identically on all ranks.
+    if(m_topology->IsLocal(iSrc))
+      {
+	const Ipv4Address& dstIpv4Addr = m_topology->GetAddress(iDst, dstAddrIdx);
+	OnOffHelper onOff("ns3::UdpSocketFactory",
+			  Address(InetSocketAddress(dstIpv4Addr, dstPort)));
+	onOff.SetConstantRate(DataRate(bps));
+	//For debug
+	//onOff.SetAttribute("MaxBytes", UintegerValue(512));
+	apps.Add(onOff.Install(m_topology->GetHost(iSrc)));
+      }
   
-    PacketSinkHelper sink("ns3::UdpSocketFactory",
-			  Address(InetSocketAddress(Ipv4Address::GetAny(), port)));
-    apps.Add(sink.Install(dstNode));
+    if(m_topology->IsLocal(iDst))
+      {
+	//Bound to the address, the same port is used once per address
+	PacketSinkHelper sink("ns3::UdpSocketFactory",
+			      Address(InetSocketAddress(m_topology->GetAddress(iDst, dstAddrIdx), dstPort)));
+	apps.Add(sink.Install(m_topology->GetHost(iDst)));
+      }
 
     apps.Start(startTime);
     apps.Stop(endTime);
   }
 
-  /*Helper Functions definations:*/
-  Ipv4Address GetIpv4Addr(Ptr<Node> hstNode)
+  uint32_t
+  NeoFlowGenerator::NextFlowId(int iDstPod, int iDstHst)
   {
-    return hstNode->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal();
+    uint32_t flowId = m_nextFlowId[m_topology->GetHostIndex(iDstPod, iDstHst)]++;
+    NS_ASSERT_MSG(flowId < m_maxFlowId, "Flow id overflow of pod " << iDstPod << " host " << iDstHst);
+    return flowId;
   }
-  
+
+  /*Consecutive flow ids to a host first take all destination ports, then the
+   *next destination address, then the next source port. The source address
+   *only spreads flows over the sender's addresses.
+   */
+  void
+  NeoFlowGenerator::GetFlowTuple(uint32_t flowId, uint32_t& srcAddrIdx, uint32_t& dstAddrIdx,
+				 uint16_t& srcPort, uint16_t& dstPort) const
+  {
+    uint32_t round = flowId / NUM_DST_PORT;
+    dstPort    = 1 + flowId % NUM_DST_PORT;
+    dstAddrIdx = round % m_numAddrPerHost;
+    srcPort    = SRC_PORT_FIRST + (round / m_numAddrPerHost) % NUM_SRC_PORT;
+    srcAddrIdx = flowId % m_numAddrPerHost;
+  }
+
+  void
+  NeoFlowGenerator::SetupTCPFlow(int32_t iSrc, int32_t iDst,
+				 uint64_t bytes, uint32_t flowId,
+				 const Time& startTime, const Time& endTime)
+  {
+    NS_ASSERT_MSG(flowId < m_maxFlowId, "Flow id " << flowId << " out of range, add addresses per host");
+    uint32_t srcAddrIdx, dstAddrIdx;
+    uint16_t srcPort, dstPort;
+    GetFlowTuple(flowId, srcAddrIdx, dstAddrIdx, srcPort, dstPort);
+    const Ipv4Address& dstIpv4Addr = m_topology->GetAddress(iDst, dstAddrIdx);
+
+    //Source ports come from the sockets. Each flow has its own PacketSink,
+    //stopping it at the flow's end closes the accepted socket, so a host
+    //does not keep the sockets of all flows it ever received.
+    ApplicationContainer apps;
+    if(m_topology->IsLocal(iSrc))
+      {
+	BulkSendHelper bulk("ns3::TcpSocketFactory",
+			    Address(InetSocketAddress(dstIpv4Addr, dstPort)));
+	bulk.SetAttribute("MaxBytes", UintegerValue(bytes));
+	apps.Add(bulk.Install(m_topology->GetHost(iSrc)));
+      }
+
+    if(m_topology->IsLocal(iDst))
+      {
+	PacketSinkHelper sink("ns3::TcpSocketFactory",
+			      Address(InetSocketAddress(dstIpv4Addr, dstPort)));
+	apps.Add(sink.Install(m_topology->GetHost(iDst)));
+      }
+
+    apps.Start(startTime);
+    apps.Stop(endTime);
+  }
+
+  const Ptr<NeoFlowSource>&
+  NeoFlowGenerator::GetFlowSource(int32_t iHost)
+  {
+    Ptr<NeoFlowSource>& source = m_flowSources[iHost];
+    if(!source)
+      {
+	source = CreateObject<NeoFlowSource>();
+	m_topology->GetHost(iHost)->AddApplication(source);
+      }
+    return source;
+  }
+
+  const Ptr<NeoFlowSink>&
+  NeoFlowGenerator::GetFlowSink(int32_t iHost)
+  {
+    Ptr<NeoFlowSink>& sink = m_flowSinks[iHost];
+    if(!sink)
+      {
+	sink = CreateObject<NeoFlowSink>();
+	m_topology->GetHost(iHost)->AddApplication(sink);
+      }
+    return sink;
+  }
+
+  uint64_t
+  NeoFlowGenerator::GetNumFlows() const
+  {
+    return m_numFlows;
+  }
+
 }
@@ -1,39 +1,100 @@
 #ifndef NEO_FLOW_GENERATOR_H
 #define NEO_FLOW_GENERATOR_H
 
+#include <fstream>
+#include <string>
 #include <vector>
 
 #include "ns3/object.h"
 #include "ns3/nstime.h"
 #include "ns3/data-rate.h"
 
+#include "neo-flow-schedule.h"
+#include "neo-flow-cdf.h"
+#include "neo-topology-index.h"
+
 namespace ns3
 {
 
-  class NodeContainer;
-  class Ipv4Address;
-  class Node;
   class ExponentialRandomVariable;
+  class UniformRandomVariable;
+  class NeoFlowSource;
+  class NeoFlowSink;
 
   class NeoFlowGenerator : public Object
   {
   public:
+    ///Generate draws the flows of every run, Record also writes them to
+    ///ScheduleFile, Replay installs the flows read back from it
+    enum ScheduleMode
+    {
+      GENERATE,
+      RECORD,
+      REPLAY
+    };
+
+    ///Applications a flow is sent and received with
+    enum FlowApplication
+    {
+      ONOFF_APPLICATION, //an OnOffApplication and a PacketSink per flow
+      NEO_FLOW_SOURCE    //one NeoFlowSource and one NeoFlowSink per host
+    };
+
+    ///How flows are drawn
+    enum Workload
+    {
+      EXPONENTIAL_WORKLOAD, //20% elephant and 80% mouse flows per host, exponential rates
+      TRACE_WORKLOAD        //empirical flow sizes and inter-arrival times
+    };
+
+    enum Transport
+    {
+      UDP_TRANSPORT,
+      TCP_TRANSPORT
+    };
+
     static TypeId GetTypeId(void);
     
     NeoFlowGenerator();
     
-    void Initialize(std::vector<NodeContainer> podHostNodes);
+    void Initialize(Ptr<const NeoTopologyIndex> topology);
     void SetupApplications();
 
+    ///Flows set up so far, over all intervals
+    uint64_t GetNumFlows() const;
+
+    ///Fix the random streams so that flows do not depend on how many
+    ///objects (e.g. apps per MPI rank) were created before; returns streams used.
+    int64_t AssignStreams(int64_t stream);
+
+  protected:
+    virtual void DoDispose(void);
+
   private:
     void SetupParameters();
+    void OpenSchedule();
+    void ReplayInterval();
+    void AddFlow(int iSrcPod, int iSrcHst, int iDstPod, int iDstHst,
+		 uint64_t bps, uint64_t bytes, uint32_t flowId,
+		 const Time& startTime, const Time& endTime);
+    void SetupFlow(const NeoFlowRecord& r);
+    uint32_t NextFlowId(int iDstPod, int iDstHst);
+    void     GetFlowTuple(uint32_t flowId, uint32_t& srcAddrIdx, uint32_t& dstAddrIdx,
+			  uint16_t& srcPort, uint16_t& dstPort) const;
 
     void SetupFlowsOriginFrom(int iSrcSub, int iSrcHst);
+    void SetupTraceFlowsOriginFrom(int iSrcSub, int iSrcHst);
     void SetupTestFlowsOriginFrom(int iSrcSub, int iSrcHst);
 
-    void SetupUDPFlow(Ptr<Node> srcNode, Ptr<Node> dstNode, 
-		      uint64_t bps, uint16_t port,
+    ///Hosts by topology index
+    void SetupUDPFlow(int32_t iSrc, int32_t iDst,
+		      uint64_t bps, uint32_t flowId,
+		      const Time& startTime, const Time& endTime);
+    void SetupTCPFlow(int32_t iSrc, int32_t iDst,
+		      uint64_t bytes, uint32_t flowId,
 		      const Time& startTime, const Time& endTime);
+    const Ptr<NeoFlowSource>& GetFlowSource(int32_t iHost);
+    const Ptr<NeoFlowSink>&   GetFlowSink(int32_t iHost);
     
     int32_t m_numExpectedFlowsPerSwtch;
     int32_t m_numInterPodFlowsPerHostPerInterval;
@@ -41,20 +102,48 @@ namespace ns3
 
     int16_t m_numHostPerPod;
     int16_t m_numPod;
+    int16_t m_numAddrPerHost;
+    int64_t m_rngStream; //Attribute
 
     Time                           m_intervalTime;       //Attribute
     Ptr<ExponentialRandomVariable> m_startTimeOffset;
-    int16_t                        m_numVirtualInterval;  //Attribute
-    int16_t                        m_idxVirtualInterval;
+    int32_t                        m_numVirtualInterval;  //Attribute
+    int32_t                        m_idxVirtualInterval;
 
 
-    std::vector<NodeContainer>          m_podHostNodes;
-    std::vector<std::vector<uint16_t> > m_nextDstPort;
+    Ptr<const NeoTopologyIndex> m_topology;
+    std::vector<uint32_t>       m_nextFlowId; //by destination host index
+    uint32_t                    m_maxFlowId;
+    uint64_t                    m_numFlows;
 
     DataRate                       m_bpsHst;  //Attribute
     Ptr<ExponentialRandomVariable> m_elephantBps;
     Ptr<ExponentialRandomVariable> m_mouseBps;
     DataRate                       m_minBps; //ensure that flows send a packet in a interval
+    uint32_t                       m_pktSize; //of UDP flows, the flow application's PacketSize
+
+    ScheduleMode  m_scheduleMode; //Attribute
+    std::string   m_scheduleFile; //Attribute
+    std::ofstream m_scheduleOut;
+    std::ifstream m_scheduleIn;
+    NeoFlowRecord m_nextRecord;   //read ahead, belongs to a later interval
+    bool          m_hasNextRecord;
+
+    FlowApplication                   m_flowApp;     //Attribute
+    std::vector<Ptr<NeoFlowSource> >  m_flowSources; //by host index
+    std::vector<Ptr<NeoFlowSink> >    m_flowSinks;   //by host index
+
+    Workload                       m_workload;            //Attribute
+    Transport                      m_transport;           //Attribute
+    std::string                    m_flowSizeCdfFile;     //Attribute
+    double                         m_flowSizeScale;       //Attribute
+    std::string                    m_interArrivalCdfFile; //Attribute
+    double                         m_load;                //Attribute
+    DataRate                       m_flowBps;             //Attribute
+    NeoEmpiricalCdf                m_flowSizeCdf;
+    NeoEmpiricalCdf                m_interArrivalCdf;     //in seconds
+    Ptr<ExponentialRandomVariable> m_interArrival;
+    Ptr<UniformRandomVariable>     m_uniform;
   };
 
 }
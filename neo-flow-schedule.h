@@ -0,0 +1,53 @@
+#ifndef NEO_FLOW_SCHEDULE_H
+#define NEO_FLOW_SCHEDULE_H
+
+#include <stdint.h>
+
+namespace ns3
+{
+
+  /*Binary flow schedule recorded by NeoFlowGenerator, native byte order:
+   *
+   *  NeoFlowScheduleHeader
+   *  NeoFlowRecord[]  in interval order
+   *
+   *Hosts are given by pod and host index, times are relative to the start
+   *of the record's interval, so a schedule replays on any run of the same
+   *topology size. The flow id gives the addresses and ports of the flow (see
+   *NeoFlowGenerator::GetFlowTuple), so the run must also keep the number of
+   *addresses per host.
+   */
+  static const char     NEO_FLOW_SCHEDULE_MAGIC[8] = {'N','E','O','F','L','O','W','S'};
+  static const uint32_t NEO_FLOW_SCHEDULE_VERSION  = 4;
+
+  struct NeoFlowScheduleHeader
+  {
+    char     magic[8];
+    uint32_t version;
+    uint16_t numPod;
+    uint16_t numHostPerPod;
+    uint32_t numInterval;
+    uint16_t numAddrPerHost;
+    uint16_t reserved;
+    int64_t  intervalTimeNs;  //a schedule replays with the same IntervalTime only
+  };
+
+  struct NeoFlowRecord
+  {
+    uint32_t interval;
+    uint32_t flowId;
+    uint16_t srcPod;
+    uint16_t srcHst;
+    uint16_t dstPod;
+    uint16_t dstHst;
+    uint8_t  prot;     //IP protocol number, UDP or TCP
+    uint8_t  reserved[7];
+    uint64_t bps;      //UDP send rate
+    uint64_t bytes;    //TCP bytes to send, 0 for what bps sends from start to stop
+    int64_t  startNs;
+    int64_t  stopNs;
+  };
+
+}
+
+#endif
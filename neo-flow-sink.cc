@@ -0,0 +1,201 @@
+#include "neo-flow-sink.h"
+
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/udp-header.h"
+#include "ns3/udp-l4-protocol.h"
+#include "ns3/ip-l4-protocol.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/ipv6-header.h"
+#include "ns3/ipv6-interface.h"
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("NeoFlowSink");
+  NS_OBJECT_ENSURE_REGISTERED(NeoFlowSink);
+
+  /*UDP handler of a host with a NeoFlowSink, inserted for each interface
+   *with Ipv4L3Protocol::Insert so it takes precedence over UdpL4Protocol.
+   *The destination port is read from the first 4 bytes as in
+   *FlowField::InitFromPacket, without deserializing the header.
+   */
+  class NeoFlowSinkProtocol : public IpL4Protocol
+  {
+  public:
+    static TypeId GetTypeId (void)
+    {
+      static TypeId tid = TypeId("ns3::NeoFlowSinkProtocol")
+	.SetParent<IpL4Protocol> ()
+	.SetGroupName ("NeoFlowMonitor");
+      return tid;
+    }
+
+    NeoFlowSinkProtocol (NeoFlowSink* sink, Ptr<UdpL4Protocol> udp)
+      : m_sink(sink), m_udp(udp)
+    {
+    }
+
+    virtual int GetProtocolNumber (void) const
+    {
+      return UdpL4Protocol::PROT_NUMBER;
+    }
+
+    virtual enum IpL4Protocol::RxStatus Receive (Ptr<Packet> p, Ipv4Header const &header,
+						 Ptr<Ipv4Interface> incomingInterface)
+    {
+      uint8_t ports[4];
+      if (m_sink && p->CopyData (ports, 4) == 4 && m_sink->IsOpen ((ports[2] << 8) | ports[3]))
+	{
+	  m_sink->Receive (p);
+	  return IpL4Protocol::RX_OK;
+	}
+      return m_udp->Receive (p, header, incomingInterface);
+    }
+
+    virtual enum IpL4Protocol::RxStatus Receive (Ptr<Packet> p, Ipv6Header const &header,
+						 Ptr<Ipv6Interface> incomingInterface)
+    {
+      return m_udp->Receive (p, header, incomingInterface);
+    }
+
+    virtual void SetDownTarget (IpL4Protocol::DownTargetCallback cb)
+    {
+    }
+
+    virtual void SetDownTarget6 (IpL4Protocol::DownTargetCallback6 cb)
+    {
+    }
+
+    virtual IpL4Protocol::DownTargetCallback GetDownTarget (void) const
+    {
+      return m_udp->GetDownTarget ();
+    }
+
+    virtual IpL4Protocol::DownTargetCallback6 GetDownTarget6 (void) const
+    {
+      return m_udp->GetDownTarget6 ();
+    }
+
+  protected:
+    virtual void DoDispose (void)
+    {
+      m_sink = 0;
+      m_udp  = 0;
+      IpL4Protocol::DoDispose ();
+    }
+
+  private:
+    NeoFlowSink*       m_sink;
+    Ptr<UdpL4Protocol> m_udp;
+  };
+
+  TypeId
+  NeoFlowSink::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::NeoFlowSink")
+      .SetParent<Application> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<NeoFlowSink> ()
+      .AddAttribute("LingerTime",
+		    "How long a port stays open after its last flow stopped, for the packets in flight",
+		    TimeValue(MilliSeconds(10)),
+		    MakeTimeAccessor(&NeoFlowSink::m_lingerTime),
+		    MakeTimeChecker());
+
+    return tid;
+  }
+
+  NeoFlowSink::NeoFlowSink ()
+    : m_isOpen(65536, false),
+      m_totalRx(0)
+  {
+  }
+
+  NeoFlowSink::~NeoFlowSink ()
+  {
+  }
+
+  void
+  NeoFlowSink::DoDispose (void)
+  {
+    if (m_protocol)
+      {
+	Ptr<Ipv4L3Protocol> ipv4 = GetNode()->GetObject<Ipv4L3Protocol> ();
+	for (uint32_t i = 0; ipv4 && i < ipv4->GetNInterfaces(); ++i)
+	  {
+	    ipv4->Remove(m_protocol, i);
+	  }
+	m_protocol->Dispose();
+	m_protocol = 0;
+      }
+    m_portFlows.clear();
+    Application::DoDispose();
+  }
+
+  void
+  NeoFlowSink::StartApplication (void)
+  {
+  }
+
+  void
+  NeoFlowSink::StopApplication (void)
+  {
+  }
+
+  void
+  NeoFlowSink::Install ()
+  {
+    Ptr<Ipv4L3Protocol> ipv4 = GetNode()->GetObject<Ipv4L3Protocol> ();
+    m_protocol = CreateObject<NeoFlowSinkProtocol> (this, GetNode()->GetObject<UdpL4Protocol> ());
+    for (uint32_t i = 0; i < ipv4->GetNInterfaces(); ++i)
+      {
+	ipv4->Insert(m_protocol, i);
+      }
+  }
+
+  void
+  NeoFlowSink::AddPort (uint16_t port, const Time& stopTime)
+  {
+    if (!m_protocol) Install();
+
+    ++m_portFlows[port];
+    m_isOpen[port] = true;
+    Simulator::Schedule(stopTime + m_lingerTime, &NeoFlowSink::RemovePort, this, port);
+  }
+
+  void
+  NeoFlowSink::RemovePort (uint16_t port)
+  {
+    std::map<uint16_t, uint32_t>::iterator it = m_portFlows.find(port);
+    NS_ASSERT(it != m_portFlows.end());
+    if (--it->second > 0) return;
+
+    NS_LOG_DEBUG("Node " << GetNode()->GetId() << " closes port " << port);
+    m_portFlows.erase(it);
+    m_isOpen[port] = false;
+  }
+
+  uint32_t
+  NeoFlowSink::GetNPorts () const
+  {
+    return m_portFlows.size();
+  }
+
+  bool
+  NeoFlowSink::IsOpen (uint16_t port) const
+  {
+    return m_isOpen[port];
+  }
+
+  void
+  NeoFlowSink::Receive (Ptr<Packet> packet)
+  {
+    //Payload bytes, as a socket would have received them
+    m_totalRx += packet->GetSize() - UdpHeader().GetSerializedSize();
+  }
+
+}
@@ -0,0 +1,59 @@
+#ifndef NEO_FLOW_SINK_H
+#define NEO_FLOW_SINK_H
+
+#include "ns3/application.h"
+#include "ns3/nstime.h"
+
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+
+  class NeoFlowSinkProtocol;
+  class Packet;
+
+  ///Discards the UDP packets of all flows to a host. The sink puts a UDP
+  ///handler in front of the node's UdpL4Protocol on every interface: a packet
+  ///to an open port is counted and dropped after one bit lookup, so the
+  ///receive cost does not grow with the ports like a scan of the end point
+  ///list does. Packets to other ports go on to UdpL4Protocol. A port is open
+  ///while it has flows, and LingerTime after the last one stopped for the
+  ///packets still in flight, so nothing is kept for finished flows.
+  class NeoFlowSink : public Application
+  {
+  public:
+    static TypeId GetTypeId (void);
+
+    NeoFlowSink ();
+    virtual ~NeoFlowSink ();
+
+    ///One flow to port until stopTime, relative to now like Application stop times
+    void     AddPort (uint16_t port, const Time& stopTime);
+    uint32_t GetNPorts () const;
+    uint64_t GetTotalRx () const;
+
+    ///From NeoFlowSinkProtocol
+    bool     IsOpen (uint16_t port) const;
+    void     Receive (Ptr<Packet> packet);
+
+  protected:
+    virtual void DoDispose (void);
+
+  private:
+    virtual void StartApplication (void);
+    virtual void StopApplication (void);
+
+    void Install ();
+    void RemovePort (uint16_t port);
+
+    Time                          m_lingerTime; //Attribute
+    Ptr<NeoFlowSinkProtocol>      m_protocol;
+    std::vector<bool>             m_isOpen;     //by port
+    std::map<uint16_t, uint32_t>  m_portFlows;  //open port -> flows not yet stopped + lingering
+    uint64_t                      m_totalRx;
+  };
+
+}
+
+#endif
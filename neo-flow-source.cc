@@ -0,0 +1,140 @@
+#include "neo-flow-source.h"
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/ipv4.h"
+#include "ns3/udp-l4-protocol.h"
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("NeoFlowSource");
+  NS_OBJECT_ENSURE_REGISTERED(NeoFlowSource);
+
+  TypeId
+  NeoFlowSource::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::NeoFlowSource")
+      .SetParent<Application> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<NeoFlowSource> ()
+      .AddAttribute("PacketSize",
+		    "The size of the packets sent, as OnOffApplication's PacketSize",
+		    UintegerValue(512),
+		    MakeUintegerAccessor(&NeoFlowSource::m_pktSize),
+		    MakeUintegerChecker<uint32_t>(1));
+
+    return tid;
+  }
+
+  NeoFlowSource::NeoFlowSource ()
+  {
+  }
+
+  NeoFlowSource::~NeoFlowSource ()
+  {
+  }
+
+  void
+  NeoFlowSource::DoDispose (void)
+  {
+    Simulator::Cancel(m_sendEvent);
+    m_udp = 0;
+    Application::DoDispose();
+  }
+
+  void
+  NeoFlowSource::StartApplication (void)
+  {
+  }
+
+  void
+  NeoFlowSource::StopApplication (void)
+  {
+    Simulator::Cancel(m_sendEvent);
+  }
+
+  void
+  NeoFlowSource::AddFlow (Ipv4Address src, uint16_t srcPort, Ipv4Address dst, uint16_t dstPort,
+			  uint64_t bps, const Time& startTime, const Time& stopTime)
+  {
+    if (!m_udp) m_udp = GetNode()->GetObject<UdpL4Protocol> ();
+    NS_ASSERT_MSG(GetNode()->GetObject<Ipv4> ()->GetInterfaceForAddress(src) >= 0,
+		  src << " is not an address of node " << GetNode()->GetId());
+
+    Flow flow;
+    flow.src      = src;
+    flow.dst      = dst;
+    flow.srcPort  = srcPort;
+    flow.dstPort  = dstPort;
+    flow.interval = Seconds(m_pktSize * 8. / bps);
+    flow.stop     = Simulator::Now() + stopTime;
+
+    uint32_t slot = m_flows.size();
+    if (m_freeSlots.empty())
+      {
+	m_flows.push_back(flow);
+      }
+    else
+      {
+	slot = m_freeSlots.back();
+	m_freeSlots.pop_back();
+	m_flows[slot] = flow;
+      }
+
+    //As OnOffApplication, the first packet leaves one interval after the start
+    Time first = Simulator::Now() + startTime + flow.interval;
+    if (first < flow.stop)
+      {
+	m_sendTimes.push(SendTime(first, slot));
+	ScheduleNext();
+      }
+    else
+      {
+	m_freeSlots.push_back(slot);
+      }
+  }
+
+  uint32_t
+  NeoFlowSource::GetNActiveFlows () const
+  {
+    return m_flows.size() - m_freeSlots.size();
+  }
+
+  void
+  NeoFlowSource::ScheduleNext ()
+  {
+    if (m_sendTimes.empty()) return;
+
+    Time next = m_sendTimes.top().first;
+    if (m_sendEvent.IsRunning() && m_sendEventTime <= next) return;
+
+    Simulator::Cancel(m_sendEvent);
+    m_sendEventTime = next;
+    m_sendEvent = Simulator::ScheduleWithContext(GetNode()->GetId(), next - Simulator::Now(),
+						 &NeoFlowSource::SendDue, this);
+  }
+
+  void
+  NeoFlowSource::SendDue ()
+  {
+    Time now = Simulator::Now();
+    while (!m_sendTimes.empty() && m_sendTimes.top().first <= now)
+      {
+	uint32_t    slot = m_sendTimes.top().second;
+	const Flow& flow = m_flows[slot];
+	m_sendTimes.pop();
+
+	m_udp->Send(Create<Packet> (m_pktSize), flow.src, flow.dst, flow.srcPort, flow.dstPort);
+
+	Time next = now + flow.interval;
+	if (next < flow.stop) m_sendTimes.push(SendTime(next, slot));
+	else                  m_freeSlots.push_back(slot);
+      }
+    ScheduleNext();
+  }
+
+}
@@ -0,0 +1,71 @@
+#ifndef NEO_FLOW_SOURCE_H
+#define NEO_FLOW_SOURCE_H
+
+#include "ns3/application.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+  class UdpL4Protocol;
+
+  ///Sends all constant rate UDP flows of a host from one application. Each
+  ///flow sends PacketSize byte packets every PacketSize * 8 / bps seconds
+  ///from start to stop, like an always-on OnOffApplication, but the flows
+  ///share one event through a queue of next send times, and packets go to
+  ///UdpL4Protocol directly instead of through a socket per flow.
+  class NeoFlowSource : public Application
+  {
+  public:
+    static TypeId GetTypeId (void);
+
+    NeoFlowSource ();
+    virtual ~NeoFlowSource ();
+
+    ///Src is one of the node's addresses. Start and stop are relative to now,
+    ///like Application start and stop times.
+    void     AddFlow (Ipv4Address src, uint16_t srcPort, Ipv4Address dst, uint16_t dstPort,
+		      uint64_t bps, const Time& startTime, const Time& stopTime);
+    uint32_t GetNActiveFlows () const;
+
+  protected:
+    virtual void DoDispose (void);
+
+  private:
+    virtual void StartApplication (void);
+    virtual void StopApplication (void);
+
+    struct Flow
+    {
+      Ipv4Address src;
+      Ipv4Address dst;
+      uint16_t    srcPort;
+      uint16_t    dstPort;
+      Time        interval;
+      Time        stop;
+    };
+    typedef std::pair<Time, uint32_t> SendTime; //(next send time, flow slot)
+
+    void SendDue ();
+    void ScheduleNext ();
+
+    uint32_t           m_pktSize; //Attribute
+    Ptr<UdpL4Protocol> m_udp;
+
+    std::vector<Flow>     m_flows;
+    std::vector<uint32_t> m_freeSlots; //slots of finished flows, reused
+    std::priority_queue<SendTime, std::vector<SendTime>, std::greater<SendTime> > m_sendTimes;
+    EventId               m_sendEvent;
+    Time                  m_sendEventTime;
+  };
+
+}
+
+#endif
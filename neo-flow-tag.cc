@@ -0,0 +1,79 @@
+#include "neo-flow-tag.h"
+
+namespace ns3
+{
+
+  NS_OBJECT_ENSURE_REGISTERED(NeoFlowTag);
+
+  TypeId
+  NeoFlowTag::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::NeoFlowTag")
+      .SetParent<Tag> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<NeoFlowTag> ();
+
+    return tid;
+  }
+
+  TypeId
+  NeoFlowTag::GetInstanceTypeId (void) const
+  {
+    return GetTypeId ();
+  }
+
+  NeoFlowTag::NeoFlowTag ()
+    : m_srcport(0), m_dstport(0), m_hash(0)
+  {
+  }
+
+  NeoFlowTag::NeoFlowTag (const FlowField& flow, uint64_t hash)
+    : m_srcport(flow.srcport), m_dstport(flow.dstport), m_hash(hash)
+  {
+  }
+
+  uint32_t
+  NeoFlowTag::GetSerializedSize (void) const
+  {
+    return 2 + 2 + 8;
+  }
+
+  void
+  NeoFlowTag::Serialize (TagBuffer i) const
+  {
+    i.WriteU16 (m_srcport);
+    i.WriteU16 (m_dstport);
+    i.WriteU64 (m_hash);
+  }
+
+  void
+  NeoFlowTag::Deserialize (TagBuffer i)
+  {
+    m_srcport = i.ReadU16 ();
+    m_dstport = i.ReadU16 ();
+    m_hash    = i.ReadU64 ();
+  }
+
+  void
+  NeoFlowTag::Print (std::ostream &os) const
+  {
+    os << "srcport=" << m_srcport << " dstport=" << m_dstport << " hash=" << m_hash;
+  }
+
+  void
+  NeoFlowTag::GetFlowField (const Ipv4Header& ipHeader, FlowField& flow) const
+  {
+    flow.ipv4srcip = ipHeader.GetSource().Get();
+    flow.ipv4dstip = ipHeader.GetDestination().Get();
+    flow.ipv4prot  = ipHeader.GetProtocol ();
+    flow.srcport   = m_srcport;
+    flow.dstport   = m_dstport;
+  }
+
+  uint64_t
+  NeoFlowTag::GetFlowHash () const
+  {
+    return m_hash;
+  }
+
+}
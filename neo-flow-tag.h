@@ -0,0 +1,41 @@
+#ifndef NEO_FLOW_TAG_H
+#define NEO_FLOW_TAG_H
+
+#include "ns3/tag.h"
+
+#include "neo-probe.h"
+
+namespace ns3
+{
+
+  ///Packet tag carrying a flow's ports, protocol and FlowFieldHash, attached by
+  ///the first probe on the path so the downstream probes neither parse the L4
+  ///header nor hash again. The addresses are read from the Ipv4Header, and all
+  ///k table indices are derived from the hash (FlowHashIndex).
+  class NeoFlowTag : public Tag
+  {
+  public:
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    NeoFlowTag ();
+    NeoFlowTag (const FlowField& flow, uint64_t hash);
+
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void     Serialize (TagBuffer i) const;
+    virtual void     Deserialize (TagBuffer i);
+    virtual void     Print (std::ostream &os) const;
+
+    ///Complete flow with the addresses and protocol of ipHeader
+    void     GetFlowField (const Ipv4Header& ipHeader, FlowField& flow) const;
+    uint64_t GetFlowHash () const;
+
+  private:
+    uint16_t m_srcport;
+    uint16_t m_dstport;
+    uint64_t m_hash;
+  };
+
+}
+
+#endif
@@ -0,0 +1,282 @@
+#include "neo-probe-dispatcher.h"
+#include "neo-flow-tag.h"
+#include "neo-topology-index.h"
+
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/object-factory.h"
+#include "ns3/uinteger.h"
+#include "ns3/integer.h"
+#include "ns3/abort.h"
+
+#include <sstream>
+
+namespace ns3
+{
+  NS_LOG_COMPONENT_DEFINE("NeoProbeDispatcher");
+  NS_OBJECT_ENSURE_REGISTERED(NeoProbeDispatcher);
+
+  //First probe stream of distributed runs, above the flow generator's 0 to 4
+  static const int64_t DISTRIBUTED_RNG_STREAM = 1000;
+
+  TypeId
+  NeoProbeDispatcher::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::NeoProbeDispatcher")
+      .SetParent<Object> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<NeoProbeDispatcher> ()
+      .AddAttribute("Probes",
+		    "Comma separated TypeId names of the probes installed on each node",
+		    StringValue("ns3::FlowRadarProbe"),
+		    MakeStringAccessor(&NeoProbeDispatcher::m_probeNames),
+		    MakeStringChecker())
+      .AddAttribute("UseFlowTag",
+		    "Set true to reuse the flow and hash tagged by the first switch on the path",
+		    BooleanValue(true),
+		    MakeBooleanAccessor(&NeoProbeDispatcher::m_useFlowTag),
+		    MakeBooleanChecker())
+      .AddAttribute("KeepRealFlowStats",
+		    "Set true to count the real flow stats once for all probes of the node",
+		    BooleanValue(true),
+		    MakeBooleanAccessor(&NeoProbeDispatcher::m_keepRealFlowStats),
+		    MakeBooleanChecker())
+      .AddAttribute("RngStream",
+		    "The first random stream of the probes, node i's probes take theirs from "
+		    "RngStream + i * STREAMS_PER_NODE on; -1 for automatic, distributed runs take "
+		    "stream 1000 then, clear of the flow generator's, so a node samples alike on any rank",
+		    IntegerValue(-1),
+		    MakeIntegerAccessor(&NeoProbeDispatcher::m_rngStream),
+		    MakeIntegerChecker<int64_t>(-1));
+
+    return tid;
+  }
+
+#ifdef NEO_PROBE_INSTRUMENT
+  //Run totals, printed when the last dispatcher is disposed
+  static uint32_t g_numDispatchers = 0;
+  static uint64_t g_totalPackets   = 0;
+  static double   g_totalProbeNs   = 0.;
+  static double   g_totalDispatchNs = 0.;
+#endif
+
+  NeoProbeDispatcher::NeoProbeDispatcher ()
+    : m_nodeId(0), m_firstStream(-1), m_numStreams(0)
+  {
+#ifdef NEO_PROBE_INSTRUMENT
+    ++g_numDispatchers;
+#endif
+  }
+
+  NeoProbeDispatcher::~NeoProbeDispatcher ()
+  {
+  }
+
+  void
+  NeoProbeDispatcher::DoDispose (void)
+  {
+#ifdef NEO_PROBE_INSTRUMENT
+    PrintInstrumentStats (std::clog);
+    //All probes of a node see its packets
+    g_totalPackets    += m_instrument.packets;
+    g_totalDispatchNs += m_instrument.packets * GetNsPerPacket ();
+    for (uint32_t i = 0; i < m_probes.size(); ++i)
+      {
+	g_totalProbeNs += m_probes[i]->GetNPackets() * m_probes[i]->GetNsPerPacket();
+      }
+    if (--g_numDispatchers == 0)
+      {
+	std::clog << "NeoProbe total Packets " << g_totalPackets << " ProbeTime " << g_totalProbeNs * 1e-9 << "s"
+		  << " NsPerPacket " << (g_totalPackets ? g_totalProbeNs / g_totalPackets : 0.)
+		  << " DispatchTime " << g_totalDispatchNs * 1e-9 << "s"
+		  << " DispatchNsPerPacket " << (g_totalPackets ? g_totalDispatchNs / g_totalPackets : 0.) << std::endl;
+      }
+#endif
+    m_probes.clear();
+    m_realFlowStats = 0;
+    Object::DoDispose();
+  }
+
+  Ptr<NeoProbeDispatcher>
+  NeoProbeDispatcher::Install (Ptr<Node> node)
+  {
+    Ptr<NeoProbeDispatcher> dispatcher = node->GetObject<NeoProbeDispatcher> ();
+    if (!dispatcher)
+      {
+	dispatcher = CreateObject<NeoProbeDispatcher> ();
+	dispatcher->Attach(node);
+      }
+    return dispatcher;
+  }
+
+  void
+  NeoProbeDispatcher::Install (const NodeContainer& nodes)
+  {
+    for (NodeContainer::Iterator it = nodes.Begin(); it != nodes.End(); ++it)
+      {
+	Install(*it);
+      }
+  }
+
+  void
+  NeoProbeDispatcher::Attach (Ptr<Node> node)
+  {
+    NS_LOG_FUNCTION(this << node->GetId());
+    m_nodeId = node->GetId();
+
+    Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol> ();
+    if (!ipv4->TraceConnectWithoutContext ("UnicastForward",
+					   MakeCallback (&NeoProbeDispatcher::ForwardLogger, this)))
+      {
+	NS_FATAL_ERROR ("UnicastForward Trace Fail");
+      }
+    node->AggregateObject(this);
+
+    if (m_keepRealFlowStats)
+      {
+	m_realFlowStats = Create<NeoRealFlowStats> ();
+      }
+
+    //Automatic streams depend on the objects a rank created before
+    int64_t rngStream = m_rngStream;
+    if (rngStream < 0 && IsDistributed()) rngStream = DISTRIBUTED_RNG_STREAM;
+    if (rngStream >= 0) m_firstStream = rngStream + m_nodeId * STREAMS_PER_NODE;
+
+    std::istringstream names (m_probeNames);
+    std::string        name;
+    while (std::getline(names, name, ','))
+      {
+	if (name.empty()) continue;
+	ObjectFactory factory;
+	factory.SetTypeId(name);
+	//Counted here, the probe would only build a table to throw away
+	if (m_realFlowStats) factory.Set("KeepRealFlowStats", BooleanValue(false));
+	AddProbe(factory.Create<NeoProbe> ());
+      }
+  }
+
+  void
+  NeoProbeDispatcher::AddProbe (Ptr<NeoProbe> probe)
+  {
+    NS_LOG_DEBUG("Node " << m_nodeId << " probe " << probe->GetInstanceTypeId().GetName());
+    probe->SetNodeId(m_nodeId);
+    if (m_realFlowStats)
+      {
+	UintegerValue expectedFlowCnt;
+	probe->GetAttribute("ExpectedFlowCount", expectedFlowCnt);
+	m_realFlowStats->Reserve(expectedFlowCnt.Get());
+	probe->SetRealFlowStats(m_realFlowStats);
+      }
+    if (m_firstStream >= 0)
+      {
+	m_numStreams += probe->AssignStreams(m_firstStream + m_numStreams);
+	NS_ABORT_MSG_IF(m_numStreams > STREAMS_PER_NODE,
+			"Node " << m_nodeId << " probes take " << m_numStreams << " random streams, "
+			<< STREAMS_PER_NODE << " at most");
+      }
+    m_probes.push_back(probe);
+  }
+
+  uint32_t
+  NeoProbeDispatcher::GetNProbes () const
+  {
+    return m_probes.size();
+  }
+
+  Ptr<NeoProbe>
+  NeoProbeDispatcher::GetProbe (uint32_t i) const
+  {
+    return m_probes[i];
+  }
+
+  const NeoProbeInstrument&
+  NeoProbeDispatcher::GetInstrument () const
+  {
+    return m_instrument;
+  }
+
+  double
+  NeoProbeDispatcher::GetNsPerPacket () const
+  {
+#ifdef NEO_PROBE_INSTRUMENT
+    if (m_instrument.sampledPackets == 0) return 0.;
+    return m_instrument.sampledTicks * NeoInstrumentNsPerTick () / m_instrument.sampledPackets;
+#else
+    return 0.;
+#endif
+  }
+
+  void
+  NeoProbeDispatcher::PrintInstrumentStats (std::ostream& os) const
+  {
+    double nsPerPacket = GetNsPerPacket ();
+    os << "Node " << m_nodeId << " " << GetInstanceTypeId().GetName()
+       << " Packets " << m_instrument.packets
+       << " Timed " << m_instrument.sampledPackets
+       << " NsPerPacket " << nsPerPacket
+       << " Mpps " << (nsPerPacket > 0. ? 1e3 / nsPerPacket : 0.)
+       << std::endl;
+    for (uint32_t i = 0; i < m_probes.size(); ++i)
+      {
+	m_probes[i]->PrintInstrumentStats (os);
+      }
+  }
+
+  void
+  NeoProbeDispatcher::ForwardLogger (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload, uint32_t interface)
+  {
+#ifdef NEO_PROBE_INSTRUMENT
+    //The probes time the same packets, their timer reads are in this time
+    if ((m_instrument.packets++ & (NEO_PROBE_INSTRUMENT_SAMPLE - 1)) == 0)
+      {
+	uint64_t start = NeoInstrumentTicks ();
+	Dispatch (ipHeader, ipPayload);
+	m_instrument.sampledTicks += NeoInstrumentTicks () - start;
+	++m_instrument.sampledPackets;
+	return;
+      }
+#endif
+    Dispatch (ipHeader, ipPayload);
+  }
+
+  void
+  NeoProbeDispatcher::Dispatch (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload)
+  {
+    FlowField flow;
+    uint64_t  hash;
+    ExtractFlow (ipHeader, ipPayload, flow, hash);
+
+    if (m_realFlowStats) m_realFlowStats->Update (flow, hash, ipHeader.GetPayloadSize());
+    for (uint32_t i = 0; i < m_probes.size(); ++i)
+      {
+	m_probes[i]->HandleForward (ipHeader, flow, hash);
+      }
+  }
+
+  void
+  NeoProbeDispatcher::ExtractFlow (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload, FlowField &flow, uint64_t &hash)
+  {
+    NeoFlowTag tag;
+    if (m_useFlowTag && ipPayload->PeekPacketTag (tag))
+      {
+	tag.GetFlowField (ipHeader, flow);
+	hash = tag.GetFlowHash ();
+#ifdef NEO_FLOW_TAG_CHECK
+	FlowField parsed; parsed.InitFromPacket (ipHeader, ipPayload);
+	NS_ASSERT_MSG(parsed == flow && FlowFieldHash (parsed) == hash, "Stale flow tag " << flow);
+#endif
+	return;
+      }
+
+    flow.InitFromPacket (ipHeader, ipPayload);
+    hash = FlowFieldHash (flow);
+    if (m_useFlowTag)
+      {
+	ipPayload->AddPacketTag (NeoFlowTag (flow, hash));
+      }
+  }
+
+}
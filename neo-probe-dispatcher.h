@@ -0,0 +1,96 @@
+#ifndef NEO_PROBE_DISPATCHER_H
+#define NEO_PROBE_DISPATCHER_H
+
+#include "neo-probe.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+  class Node;
+  class NodeContainer;
+
+  ///Owns the one UnicastForward connection of a node. Every forwarded packet
+  ///is parsed and hashed once (or read from its NeoFlowTag) and handed to all
+  ///registered probes. The probes of a node are created from the Probes
+  ///attribute, a comma separated list of TypeId names, e.g.
+  ///  --ns3::NeoProbeDispatcher::Probes=ns3::FlowRadarProbe,ns3::FlowMapProbe
+  ///With KeepRealFlowStats the dispatcher counts the node's real flow stats
+  ///once per packet and every probe added reads them. The probes of a node
+  ///take random streams from RngStream + node id * STREAMS_PER_NODE on.
+  ///Built with -DNEO_FLOW_TAG_CHECK, every tagged packet is parsed and hashed
+  ///again and checked against its tag, which costs the fast path it skips.
+  ///Built with NEO_PROBE_INSTRUMENT, each dispatcher prints the instrument
+  ///stats of its probes to std::clog when disposed, the last one the totals.
+  ///The dispatcher also times its whole ForwardLogger (parse or tag lookup,
+  ///hash, real flow stats and all probes), sampled like the probes.
+  class NeoProbeDispatcher : public Object
+  {
+  public:
+    static TypeId GetTypeId (void);
+
+    ///Random streams the probes of one node may use
+    static const int64_t STREAMS_PER_NODE = 16;
+
+    NeoProbeDispatcher ();
+    virtual ~NeoProbeDispatcher ();
+
+    ///The dispatcher aggregated to node, created with its probes on first call
+    static Ptr<NeoProbeDispatcher> Install (Ptr<Node> node);
+    static void                    Install (const NodeContainer& nodes);
+
+    ///The probe reads the dispatcher's real flow stats if it keeps them,
+    ///and takes the node's next random streams unless they are automatic
+    void          AddProbe (Ptr<NeoProbe> probe);
+    uint32_t      GetNProbes () const;
+    Ptr<NeoProbe> GetProbe (uint32_t i) const;
+    ///First probe of type T, 0 if none
+    template <typename T>
+    Ptr<T>        GetProbe () const;
+
+    ///ForwardLogger counters of the node, all zero unless built with NEO_PROBE_INSTRUMENT
+    const NeoProbeInstrument& GetInstrument () const;
+    double                    GetNsPerPacket () const;
+    ///The node's ForwardLogger time, then NeoProbe::PrintInstrumentStats of all probes
+    void          PrintInstrumentStats (std::ostream& os) const;
+
+  protected:
+    virtual void DoDispose (void);
+
+  private:
+    void Attach (Ptr<Node> node);
+    void ForwardLogger (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload, uint32_t interface);
+    void Dispatch (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload);
+    void ExtractFlow (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload, FlowField &flow, uint64_t &hash);
+
+    std::string m_probeNames; //Attribute
+    bool        m_useFlowTag; //Attribute
+    bool        m_keepRealFlowStats; //Attribute
+    int64_t     m_rngStream;  //Attribute
+    uint32_t    m_nodeId;
+    int64_t     m_firstStream; //of the node's probes, -1 for automatic
+    int64_t     m_numStreams;  //taken by the probes added
+
+    Ptr<NeoRealFlowStats>       m_realFlowStats;
+    NeoProbeInstrument          m_instrument;
+
+    std::vector<Ptr<NeoProbe> > m_probes;
+  };
+
+  template <typename T>
+  Ptr<T>
+  NeoProbeDispatcher::GetProbe () const
+  {
+    for (uint32_t i = 0; i < m_probes.size(); ++i)
+      {
+	Ptr<T> probe = DynamicCast<T> (m_probes[i]);
+	if (probe) return probe;
+      }
+    return 0;
+  }
+
+}
+
+#endif
@@ -1,7 +1,13 @@
 #include "neo-probe.h"
+#include "neo-stats-writer.h"
 
-#include "ns3/node.h"
 #include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/icmpv4-l4-protocol.h"
 
 #include <fstream>
 #include <sstream>
@@ -12,12 +18,41 @@ namespace ns3
   NS_LOG_COMPONENT_DEFINE("NeoProbe");
   NS_OBJECT_ENSURE_REGISTERED(NeoProbe);
 
+  /*Fast path: UDP and TCP both carry the ports in the first 4 bytes of the
+   *L4 header, so only those bytes are copied out of the packet buffer.
+   *Other protocols (e.g. ICMP) and non-first fragments have zero ports.
+   */
   void 
   FlowField::InitFromPacket(const Ipv4Header& ipHeader, Ptr<const Packet> ipPayload)
   {
     ipv4srcip = ipHeader.GetSource().Get();
     ipv4dstip = ipHeader.GetDestination().Get();
     ipv4prot  = ipHeader.GetProtocol ();
+    srcport   = 0;
+    dstport   = 0;
+    if ((ipv4prot == UdpL4Protocol::PROT_NUMBER || ipv4prot == TcpL4Protocol::PROT_NUMBER)
+	&& ipHeader.GetFragmentOffset () == 0)
+      {
+	uint8_t ports[4];
+	if (ipPayload->CopyData (ports, 4) == 4)
+	  {
+	    srcport = (ports[0] << 8) | ports[1];
+	    dstport = (ports[2] << 8) | ports[3];
+	  }
+      }
+  }
+
+  /*Reference path deserializing the whole UDP/TCP header,
+   *kept to check and benchmark the fast path against.
+   */
+  void 
+  FlowField::InitFromPacketHeaders(const Ipv4Header& ipHeader, Ptr<const Packet> ipPayload)
+  {
+    ipv4srcip = ipHeader.GetSource().Get();
+    ipv4dstip = ipHeader.GetDestination().Get();
+    ipv4prot  = ipHeader.GetProtocol ();
+    srcport   = 0;
+    dstport   = 0;
     if (ipv4prot == UdpL4Protocol::PROT_NUMBER)
       {
 	UdpHeader udpHeader;
@@ -32,10 +67,16 @@ namespace ns3
 	srcport = tcpHeader.GetSourcePort ();
 	dstport = tcpHeader.GetDestinationPort ();
       }
-    else
-      {
-	NS_FATAL_ERROR("Protocol not supported");
-      }
+  }
+
+  void
+  FlowField::Xor(const FlowField& rhs)
+  {
+    ipv4srcip ^= rhs.ipv4srcip;
+    ipv4dstip ^= rhs.ipv4dstip;
+    srcport   ^= rhs.srcport;
+    dstport   ^= rhs.dstport;
+    ipv4prot  ^= rhs.ipv4prot;
   }
 
   bool
@@ -52,9 +93,12 @@ namespace ns3
   operator<< (std::ostream& os, const FlowField& flow)
   {
     Ipv4Address srcip (flow.ipv4srcip), dstip (flow.ipv4dstip);
-    std::string prot = (flow.ipv4prot == UdpL4Protocol::PROT_NUMBER) ? "UDP" : "TCP" ;
-
-    os << srcip << " " << dstip << " " << prot << " " << flow.srcport << " " << flow.dstport ;
+    os << srcip << " " << dstip << " ";
+    if      (flow.ipv4prot == UdpL4Protocol::PROT_NUMBER)    os << "UDP";
+    else if (flow.ipv4prot == TcpL4Protocol::PROT_NUMBER)    os << "TCP";
+    else if (flow.ipv4prot == Icmpv4L4Protocol::PROT_NUMBER) os << "ICMP";
+    else                                                     os << (uint32_t)flow.ipv4prot;
+    os << " " << flow.srcport << " " << flow.dstport ;
     
     return os;
   }
@@ -73,23 +117,59 @@ namespace ns3
     
     static TypeId tid = TypeId("ns3::NeoProbe")
       .SetParent<Object> ()
-      .SetGroupName ("NeoFlowMonitor");
+      .SetGroupName ("NeoFlowMonitor")
+      .AddAttribute("ExpectedFlowCount",
+		    "The num of flows the real flow stats table is sized for up front",
+		    UintegerValue(1000),
+		    MakeUintegerAccessor(&NeoProbe::m_expectedFlowCnt),
+		    MakeUintegerChecker<uint32_t>())
+      .AddAttribute("KeepRealFlowStats",
+		    "Set false to skip the real flow stats, the dispatcher turns it off for the probes it creates "
+		    "and shares its own",
+		    BooleanValue(true),
+		    MakeBooleanAccessor(&NeoProbe::m_keepRealFlowStats),
+		    MakeBooleanChecker())
+      .AddAttribute("EpochTime",
+		    "The time of a measurement epoch, zero (the default) to never roll over",
+		    TimeValue(Seconds(0)),
+		    MakeTimeAccessor(&NeoProbe::m_epochTime),
+		    MakeTimeChecker())
+      .AddAttribute("NumOfEpochs",
+		    "The num of epochs rolled over, zero for no limit: the run then ends with Simulator::Stop",
+		    UintegerValue(0),
+		    MakeUintegerAccessor(&NeoProbe::m_numEpochs),
+		    MakeUintegerChecker<uint32_t>())
+      .AddAttribute("InstrumentPackets",
+		    "The num of packets handled, counted with NEO_PROBE_INSTRUMENT",
+		    TypeId::ATTR_GET,
+		    UintegerValue(0),
+		    MakeUintegerAccessor(&NeoProbe::GetNPackets),
+		    MakeUintegerChecker<uint64_t>())
+      .AddAttribute("InstrumentNsPerPacket",
+		    "The mean ForwardLogger time in ns, sampled with NEO_PROBE_INSTRUMENT",
+		    TypeId::ATTR_GET,
+		    DoubleValue(0.),
+		    MakeDoubleAccessor(&NeoProbe::GetNsPerPacket),
+		    MakeDoubleChecker<double>())
+      .AddTraceSource("EpochEnd",
+		      "An epoch ended, its tables are frozen",
+		      MakeTraceSourceAccessor(&NeoProbe::m_epochEndTrace),
+		      "ns3::NeoProbe::EpochEndCallback")
+      .AddTraceSource("Instrument",
+		      "The hot path counters at the end of an epoch, counted since the start",
+		      MakeTraceSourceAccessor(&NeoProbe::m_instrumentTrace),
+		      "ns3::NeoProbe::InstrumentCallback");
 
     return tid;
   }
 
-  NeoProbe::NeoProbe (Ptr<Node> node)
+  NeoProbe::NeoProbe ()
+    : m_epoch(0), m_nodeId(0)
   {
-    NS_LOG_FUNCTION(this << node->GetId());
-    m_ipv4 = node->GetObject<Ipv4L3Protocol> ();
-
-    if (!m_ipv4->TraceConnectWithoutContext ("UnicastForward",
-					     MakeCallback (&NeoProbe::ForwardLogger, Ptr<NeoProbe> (this))))
-      {
-	NS_FATAL_ERROR ("UnicastForward Trace Fail");
-      }
-
-    m_nodeId = node->GetId();
+    NS_LOG_FUNCTION(this);
+#ifdef NEO_PROBE_INSTRUMENT
+    NeoInstrumentNsPerTick (); //start the calibration
+#endif
   }
   
   NeoProbe::~NeoProbe ()
@@ -97,36 +177,252 @@ namespace ns3
   }
 
   void
-  NeoProbe::UpdateRealFlowStats (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload)
+  NeoProbe::NotifyConstructionCompleted (void)
   {
-    
-    FlowField flow; flow.InitFromPacket(ipHeader, ipPayload);
-    FlowStatContainerI it = m_realFlowStats.find (flow);
-    if (it == m_realFlowStats.end())
+    Object::NotifyConstructionCompleted ();
+    if (m_keepRealFlowStats && !m_realFlowStats)
+      {
+	m_realFlowStats = Create<NeoRealFlowStats> ();
+	m_realFlowStats->Reserve (m_expectedFlowCnt);
+      }
+
+    if (!m_epochTime.IsZero())
+      {
+	Simulator::Schedule (m_epochTime, &NeoProbe::RollOver, this);
+      }
+  }
+
+  void
+  NeoProbe::RollOver ()
+  {
+    NS_LOG_DEBUG("Node " << m_nodeId << " epoch " << m_epoch << " ends with "
+		 << GetRealFlowStats().size() << " flows");
+
+    if (m_realFlowStats) m_realFlowStats->RollOver (m_epoch);
+    DoRollOver ();
+
+    uint32_t epoch = m_epoch++;
+    m_epochEndTrace (this, epoch);
+    m_instrumentTrace (this, epoch, m_instrument);
+
+    if (!m_epochTime.IsZero() && (m_numEpochs == 0 || m_epoch < m_numEpochs))
       {
-	m_realFlowStats[flow] = PckByteField();
+	Simulator::Schedule (m_epochTime, &NeoProbe::RollOver, this);
       }
+  }
+
+  uint32_t
+  NeoProbe::GetEpoch () const
+  {
+    return m_epoch;
+  }
+
+  //Stands in for the real flow stats of a probe that keeps none
+  static const FlowStatContainer g_noFlowStats;
+
+  const FlowStatContainer&
+  NeoProbe::GetEpochFlowStats () const
+  {
+    return m_realFlowStats ? m_realFlowStats->GetEpoch () : g_noFlowStats;
+  }
+
+  const NeoProbeInstrument&
+  NeoProbe::GetInstrument () const
+  {
+    return m_instrument;
+  }
+
+  uint64_t
+  NeoProbe::GetNPackets () const
+  {
+    return m_instrument.packets;
+  }
+
+  double
+  NeoProbe::GetNsPerPacket () const
+  {
+#ifdef NEO_PROBE_INSTRUMENT
+    if (m_instrument.sampledPackets == 0) return 0.;
+    return m_instrument.sampledTicks * NeoInstrumentNsPerTick () / m_instrument.sampledPackets;
+#else
+    return 0.;
+#endif
+  }
+
+  int64_t
+  NeoProbe::AssignStreams (int64_t stream)
+  {
+    return 0;
+  }
+
+  static void
+  PrintTableStats (std::ostream& os, const char* name, const FlowStatContainer& table)
+  {
+    std::vector<uint64_t> lengths (8, 0);
+    table.ProbeLengths (lengths);
+    os << " " << name << " " << table.size() << "/" << table.capacity()
+       << " Load " << (table.capacity() ? (double)table.size() / table.capacity() : 0.)
+       << " ProbeLengths";
+    for (uint32_t i = 0; i < lengths.size(); ++i) os << " " << lengths[i];
+  }
+
+  void
+  NeoProbe::PrintInstrumentStats (std::ostream& os) const
+  {
+    double nsPerPacket = GetNsPerPacket ();
+    os << "Node " << m_nodeId << " " << GetInstanceTypeId().GetName()
+       << " Packets " << m_instrument.packets
+       << " Timed " << m_instrument.sampledPackets
+       << " NsPerPacket " << nsPerPacket
+       << " Mpps " << (nsPerPacket > 0. ? 1e3 / nsPerPacket : 0.);
+    PrintTableStats (os, "RealTable", GetRealFlowStats ());
+    PrintTableStats (os, "EpochTable", GetEpochFlowStats ());
+    os << std::endl;
+  }
 
-    m_realFlowStats[flow].pckcnt  += 1;
-    m_realFlowStats[flow].bytecnt += ipHeader.GetPayloadSize();
+#ifdef NEO_PROBE_INSTRUMENT
+  double
+  NeoInstrumentNsPerTick ()
+  {
+    static const uint64_t                              startTicks = NeoInstrumentTicks ();
+    static const std::chrono::steady_clock::time_point startTime  = std::chrono::steady_clock::now ();
+
+    uint64_t ticks = NeoInstrumentTicks () - startTicks;
+    double   ns    = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - startTime).count ();
+    return ticks ? ns / ticks : 1.;
+  }
+#endif
+
+  void
+  NeoProbe::SetNodeId (uint32_t nodeId)
+  {
+    m_nodeId = nodeId;
+  }
+
+  uint32_t
+  NeoProbe::GetNodeId () const
+  {
+    return m_nodeId;
+  }
+
+  void
+  NeoProbe::UpdateRealFlowStats (const FlowField &flow, uint64_t hash, uint32_t byteCnt)
+  {
+    //Shared stats are counted by their owner
+    if (!m_keepRealFlowStats) return;
+
+    m_realFlowStats->Update (flow, hash, byteCnt);
+  }
 
-    NS_LOG_DEBUG(flow <<" "<< m_realFlowStats[flow]);
+  const FlowStatContainer&
+  NeoProbe::GetRealFlowStats () const
+  {
+    return m_realFlowStats ? m_realFlowStats->GetCurrent () : g_noFlowStats;
+  }
 
+  void
+  NeoProbe::SetRealFlowStats (Ptr<NeoRealFlowStats> stats)
+  {
+    m_realFlowStats     = stats;
+    m_keepRealFlowStats = false;
+  }
+
+  ///Sum stats into total, flow by flow
+  static void
+  AddFlowStats (FlowStatContainer& total, const FlowStatContainer& stats)
+  {
+    for (FlowStatContainerCI ci = stats.cbegin(); ci != stats.cend(); ++ci)
+      {
+	PckByteField& sum = total.FindOrInsert (ci->first, FlowFieldHash (ci->first));
+	sum.pckcnt  = SaturatingAdd<uint64_t> (sum.pckcnt, ci->second.pckcnt);
+	sum.bytecnt = SaturatingAdd<uint64_t> (sum.bytecnt, ci->second.bytecnt);
+      }
   }
 
   void
   NeoProbe::PrintRealFlowStats (std::string fileNameSuffix) const
+  {
+    //Without a rollover the current table holds the whole run
+    if (!m_realFlowStats || m_realFlowStats->GetTotal ().empty ())
+      {
+	PrintFlowStats (fileNameSuffix, GetRealFlowStats ());
+	return;
+      }
+    FlowStatContainer total (m_realFlowStats->GetTotal ());
+    AddFlowStats (total, m_realFlowStats->GetCurrent ());
+    PrintFlowStats (fileNameSuffix, total);
+  }
+
+  void
+  NeoProbe::PrintFlowStats (std::string fileNameSuffix, const FlowStatContainer& stats) const
   {
     std::stringstream ss;       ss << m_nodeId << "-" << fileNameSuffix;
     std::string       filename; ss >> filename;
     std::ofstream     file (filename.c_str());
     NS_ASSERT(file);
     
-    file << "TotalFlowCnt " << m_realFlowStats.size() << std::endl;
-    for(FlowStatContainerCI ci = m_realFlowStats.cbegin(); ci != m_realFlowStats.cend(); ++ci)
+    file << "TotalFlowCnt " << stats.size() << std::endl;
+    for(FlowStatContainerCI ci = stats.cbegin(); ci != stats.cend(); ++ci)
       {
 	file << ci->first << " " << ci->second << std::endl;
       }
   }
   
+  void
+  NeoProbe::ExportRealFlowStats (Ptr<NeoStatsWriter> writer, uint32_t interval) const
+  {
+    writer->WriteBlock (interval, m_nodeId, GetRealFlowStats ());
+  }
+
+  NeoRealFlowStats::NeoRealFlowStats ()
+    : m_nextEpoch(0)
+  {
+  }
+
+  void
+  NeoRealFlowStats::Reserve (uint32_t expectedFlowCnt)
+  {
+    m_current.reserve (expectedFlowCnt);
+    m_epoch.reserve (expectedFlowCnt);
+  }
+
+  void
+  NeoRealFlowStats::Update (const FlowField &flow, uint64_t hash, uint32_t byteCnt)
+  {
+    PckByteField& stats = m_current.FindOrInsert(flow, hash);
+    stats.Add(byteCnt);
+
+    NS_LOG_DEBUG(flow <<" "<< stats);
+  }
+
+  void
+  NeoRealFlowStats::RollOver (uint32_t epoch)
+  {
+    if (epoch != m_nextEpoch) return;
+    ++m_nextEpoch;
+
+    //Swap the tables, the recycled one is cleared for the new epoch in O(1)
+    m_epoch.swap (m_current);
+    m_current.clear ();
+    AddFlowStats (m_total, m_epoch);
+  }
+
+  const FlowStatContainer&
+  NeoRealFlowStats::GetCurrent () const
+  {
+    return m_current;
+  }
+
+  const FlowStatContainer&
+  NeoRealFlowStats::GetEpoch () const
+  {
+    return m_epoch;
+  }
+
+  const FlowStatContainer&
+  NeoRealFlowStats::GetTotal () const
+  {
+    return m_total;
+  }
+
 }
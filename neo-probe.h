@@ -2,17 +2,28 @@
 #define NEO_PROBE_H
 
 #include "ns3/object.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
 #include "ns3/ipv4-l3-protocol.h"
 #include "ns3/udp-l4-protocol.h"
 #include "ns3/tcp-l4-protocol.h"
 #include "ns3/tcp-header.h"
 #include "ns3/udp-header.h"
 
+#include "flat-hash-map.h"
+#include "neo-counter.h"
+
 #include <iostream>
-#include <boost/functional/hash.hpp>
-#include <boost/unordered_map.hpp>
 #include <string>
 
+#ifdef NEO_PROBE_INSTRUMENT
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
 namespace ns3
 {
 
@@ -20,6 +31,8 @@ namespace ns3
 
   ///Table Fields
   ///1.Flow Field
+  ///13 bytes of 5-tuple, padded to sizeof(FlowField) == 16 so the addresses
+  ///stay aligned in the tables and the hash reads them as whole words.
   struct FlowField
   {
     uint32_t ipv4srcip;
@@ -36,50 +49,159 @@ namespace ns3
     }
     
     void InitFromPacket(const Ipv4Header& ipHeader, Ptr<const Packet> ipPayload);
+    void InitFromPacketHeaders(const Ipv4Header& ipHeader, Ptr<const Packet> ipPayload);
+    void Xor(const FlowField& rhs);
   };
   bool          operator== (const FlowField& lhs, const FlowField& rhs);
   std::ostream& operator<< (std::ostream& os, const FlowField& flow);
 
+  ///Flow hash, one 64-bit mix over the 5-tuple.
+  ///Probes derive their k table indices from it by double hashing,
+  ///so a packet is hashed once no matter how many tables it updates.
+  inline uint64_t
+  FlowHashMix (uint64_t h)
+  {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  inline uint64_t
+  FlowFieldHash (const FlowField& f, uint64_t seed = 0)
+  {
+    uint64_t a = ((uint64_t)f.ipv4srcip << 32) | f.ipv4dstip;
+    uint64_t b = ((uint64_t)f.srcport << 24) | ((uint64_t)f.dstport << 8) | f.ipv4prot;
+    return FlowHashMix (FlowHashMix (a ^ seed) ^ b);
+  }
+
+  ///The i-th index in [0, n) of a flow hash
+  inline uint32_t
+  FlowHashIndex (uint64_t hash, uint32_t i, uint32_t n)
+  {
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    return (h1 + i * h2) % n;
+  }
+
+  ///The i-th +1/-1 sign of a flow hash, from the bit above the index bits
+  inline int32_t
+  FlowHashSign (uint64_t hash, uint32_t i)
+  {
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    return ((h1 + i * h2) >> 31) ? 1 : -1;
+  }
+
   ///2.Pakcet Byte Counter Field
+  ///Ground truth counters, 64 bits and saturating so no flow ever wraps
   struct PckByteField
   {
-    uint16_t pckcnt;
-    uint32_t bytecnt;
+    uint64_t pckcnt;
+    uint64_t bytecnt;
 
     PckByteField ()
       : pckcnt(0), bytecnt(0)
     {
     }
+
+    ///Count one packet of byteCnt bytes
+    void Add (uint64_t byteCnt)
+    {
+      pckcnt  = SaturatingAdd<uint64_t> (pckcnt, 1);
+      bytecnt = SaturatingAdd<uint64_t> (bytecnt, byteCnt);
+    }
   };
   std::ostream& operator<< (std::ostream& os, const PckByteField& pckbyte);
 
   ///Flow statics container type
-  struct FlowFieldBoostHash
-    : std::unary_function<FlowField, std::size_t>
+  struct FlowFieldHasher
   {
-    std::size_t operator()(FlowField const& f) const
+    uint64_t operator()(FlowField const& f) const
     {
-      std::size_t seed = 0;
-      boost::hash_combine(seed, f.ipv4srcip);
-      boost::hash_combine(seed, f.ipv4dstip);
-      boost::hash_combine(seed, f.srcport);
-      boost::hash_combine(seed, f.dstport);
-      boost::hash_combine(seed, f.ipv4prot);
-      return seed;
+      return FlowFieldHash(f);
     }
   };
-  typedef boost::unordered_map<FlowField, PckByteField, FlowFieldBoostHash>                 FlowStatContainer;
-  typedef boost::unordered_map<FlowField, PckByteField, FlowFieldBoostHash>::iterator       FlowStatContainerI;
-  typedef boost::unordered_map<FlowField, PckByteField, FlowFieldBoostHash>::const_iterator FlowStatContainerCI;
+  typedef FlatHashMap<FlowField, PckByteField, FlowFieldHasher>                 FlowStatContainer;
+  typedef FlatHashMap<FlowField, PckByteField, FlowFieldHasher>::iterator       FlowStatContainerI;
+  typedef FlatHashMap<FlowField, PckByteField, FlowFieldHasher>::const_iterator FlowStatContainerCI;
+
+  ///Real flow stats of one node, the current epoch's and the last one's.
+  ///The NeoProbeDispatcher counts every packet into them once and all probes
+  ///of the node read the same tables, so N probes do not keep N copies.
+  class NeoRealFlowStats : public SimpleRefCount<NeoRealFlowStats>
+  {
+  public:
+    NeoRealFlowStats ();
+
+    void Reserve (uint32_t expectedFlowCnt);
+    void Update (const FlowField &flow, uint64_t hash, uint32_t byteCnt);
+    ///Freeze the current flows as those of epoch. Every probe sharing the
+    ///stats calls it, only the first call of an epoch swaps the tables.
+    void RollOver (uint32_t epoch);
+
+    const FlowStatContainer& GetCurrent () const;
+    const FlowStatContainer& GetEpoch () const;
+    ///Flows of all epochs rolled over, the current one not yet added
+    const FlowStatContainer& GetTotal () const;
+
+  private:
+    FlowStatContainer m_current;
+    FlowStatContainer m_epoch;
+    FlowStatContainer m_total;
+    uint32_t          m_nextEpoch; //the epoch the next RollOver freezes
+  };
   
   
-  class Node;
+  /*Hot path instrumentation, compiled in with -DNEO_PROBE_INSTRUMENT so that
+   *it costs nothing otherwise. One in NEO_PROBE_INSTRUMENT_SAMPLE (a power of
+   *2) ForwardLogger calls is timed, with the TSC on x86 and steady_clock
+   *elsewhere.
+   */
+#ifdef NEO_PROBE_INSTRUMENT
+#ifndef NEO_PROBE_INSTRUMENT_SAMPLE
+#define NEO_PROBE_INSTRUMENT_SAMPLE 16
+#endif
+
+  inline uint64_t
+  NeoInstrumentTicks ()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc ();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>
+      (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+#endif
+  }
+
+  ///Nanoseconds per tick, measured against steady_clock since the first call
+  double NeoInstrumentNsPerTick ();
+#endif
+
+  struct NeoProbeInstrument
+  {
+    uint64_t packets;        //ForwardLogger calls
+    uint64_t sampledPackets; //calls timed
+    uint64_t sampledTicks;   //ticks spent in the timed calls
+
+    NeoProbeInstrument ()
+      : packets(0), sampledPackets(0), sampledTicks(0)
+    {
+    }
+  };
 
+  class NeoStatsWriter;
+
+  ///A measurement module. It does not hook into the node itself: the node's
+  ///NeoProbeDispatcher parses and hashes each forwarded packet once and hands
+  ///the flow to all its probes through ForwardLogger.
   class NeoProbe : public Object
   {
   protected:
     /// Constructor, subclass call
-    NeoProbe (Ptr<Node> node);
+    NeoProbe ();
   public:
     virtual ~NeoProbe ();
     static TypeId GetTypeId (void);
@@ -88,19 +210,88 @@ namespace ns3
     NeoProbe& operator= (const NeoProbe& rhs);
 
   public:
-    void PrintRealFlowStats (std::string fileNameSuffix) const;
+    ///A forwarded packet of flow, hashed with FlowFieldHash
+    virtual void ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash) = 0;
+    ///The dispatcher's entry, ForwardLogger counted and timed when instrumented
+    void         HandleForward (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash);
+
+    ///Hot path counters, all zero unless built with NEO_PROBE_INSTRUMENT
+    const NeoProbeInstrument& GetInstrument () const;
+    uint64_t                  GetNPackets () const;
+    double                    GetNsPerPacket () const;
+    ///Packets, time per packet, and load and probe lengths of the flow tables
+    virtual void              PrintInstrumentStats (std::ostream& os) const;
+    ///Bytes the measurement tables of one epoch take on a switch
+    virtual uint64_t          GetMemoryBytes () const = 0;
+    ///Fix the random streams of a probe that draws random numbers, starting
+    ///at stream; returns the streams used, 0 by default
+    virtual int64_t           AssignStreams (int64_t stream);
+
+    ///Set by the dispatcher the probe is added to
+    void     SetNodeId (uint32_t nodeId);
+    uint32_t GetNodeId () const;
+    ///The real flow stats of the whole run, over all epochs
+    void     PrintRealFlowStats (std::string fileNameSuffix) const;
+    void     ExportRealFlowStats (Ptr<NeoStatsWriter> writer, uint32_t interval) const;
+
+    const FlowStatContainer& GetRealFlowStats () const;
+    ///Read the real flow stats someone else counts (the node's dispatcher)
+    ///instead of keeping them; the sharing probes need the same EpochTime
+    void                     SetRealFlowStats (Ptr<NeoRealFlowStats> stats);
+
+    /*Epochs, off unless EpochTime is set: every EpochTime the probe freezes
+     *its tables and keeps counting in fresh ones. The frozen tables stay
+     *readable until the next rollover, EpochEnd tells the export or decode
+     *stage they are ready.
+     */
+    void                     RollOver ();
+    uint32_t                 GetEpoch () const;
+    const FlowStatContainer& GetEpochFlowStats () const;
+
+    typedef void (* EpochEndCallback)(Ptr<const NeoProbe> probe, uint32_t epoch);
+    typedef void (* InstrumentCallback)(Ptr<const NeoProbe> probe, uint32_t epoch,
+					const NeoProbeInstrument& instrument);
 
   protected:
-            void UpdateRealFlowStats (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload);
-    virtual void ForwardLogger (const Ipv4Header &ipHeader, Ptr<const Packet> ipPayload, uint32_t interface) = 0;
+            void UpdateRealFlowStats (const FlowField &flow, uint64_t hash, uint32_t byteCnt);
     virtual void PrintMeasurementStats (std::string fileNameSuffix) const = 0;
+    ///The PrintRealFlowStats file of any flow stats
+            void PrintFlowStats (std::string fileNameSuffix, const FlowStatContainer& stats) const;
+
+    virtual void NotifyConstructionCompleted (void);
+    ///Subclass swaps its own measurement tables, called by RollOver
+    virtual void DoRollOver () = 0;
   
   private:
+    uint32_t            m_expectedFlowCnt; //Attribute
+    bool                m_keepRealFlowStats; //Attribute
+    Time                m_epochTime;       //Attribute
+    uint32_t            m_numEpochs;       //Attribute
+    uint32_t            m_epoch;
     uint32_t            m_nodeId;
-    Ptr<Ipv4L3Protocol> m_ipv4; //the Ipv4L3Protocol this probe is bound to
-    FlowStatContainer   m_realFlowStats;
+    Ptr<NeoRealFlowStats> m_realFlowStats; //0 if not kept
+    NeoProbeInstrument  m_instrument;
+
+    TracedCallback<Ptr<const NeoProbe>, uint32_t> m_epochEndTrace;
+    TracedCallback<Ptr<const NeoProbe>, uint32_t, const NeoProbeInstrument&> m_instrumentTrace;
   };
 
+  inline void
+  NeoProbe::HandleForward (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash)
+  {
+#ifdef NEO_PROBE_INSTRUMENT
+    if ((m_instrument.packets++ & (NEO_PROBE_INSTRUMENT_SAMPLE - 1)) == 0)
+      {
+	uint64_t start = NeoInstrumentTicks ();
+	ForwardLogger (ipHeader, flow, hash);
+	m_instrument.sampledTicks += NeoInstrumentTicks () - start;
+	++m_instrument.sampledPackets;
+	return;
+      }
+#endif
+    ForwardLogger (ipHeader, flow, hash);
+  }
+
 }
 
 
@@ -0,0 +1,58 @@
+#ifndef NEO_STATS_FORMAT_H
+#define NEO_STATS_FORMAT_H
+
+#include <stdint.h>
+
+namespace ns3
+{
+
+  /*Binary flow stats file, one per run, native byte order:
+   *
+   *  NeoStatsFileHeader
+   *  block 0 .. block n-1   one per (interval, switch), 8-byte aligned
+   *  NeoStatsBlockIndex[n]  at header.indexOffset
+   *
+   *A block of m flows is stored column by column, each column fixed width
+   *and padded to 8 bytes, in this order:
+   *  uint64 pckcnt[m], uint64 bytecnt[m], uint32 srcip[m], uint32 dstip[m],
+   *  uint16 srcport[m], uint16 dstport[m], uint8 prot[m]
+   *so every column can be mapped as a plain array (e.g. numpy.frombuffer).
+   */
+  static const char     NEO_STATS_MAGIC[8]   = {'N','E','O','S','T','A','T','S'};
+  static const uint32_t NEO_STATS_VERSION    = 1;
+  static const uint32_t NEO_STATS_BYTE_ORDER = 0x01020304;
+
+  struct NeoStatsFileHeader
+  {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t numBlocks;
+    uint64_t indexOffset;
+  };
+
+  struct NeoStatsBlockIndex
+  {
+    uint32_t interval;
+    uint32_t nodeId;
+    uint64_t offset;
+    uint64_t numFlows;
+  };
+
+  inline uint64_t
+  NeoStatsAlign (uint64_t n)
+  {
+    return (n + 7) & ~(uint64_t)7;
+  }
+
+  ///Byte size of a block of numFlows flows
+  inline uint64_t
+  NeoStatsBlockSize (uint64_t numFlows)
+  {
+    return 2 * 8 * numFlows + 2 * NeoStatsAlign (4 * numFlows)
+      + 2 * NeoStatsAlign (2 * numFlows) + NeoStatsAlign (numFlows);
+  }
+
+}
+
+#endif
@@ -0,0 +1,177 @@
+#include "neo-stats-reader.h"
+
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+  NeoStatsReader::NeoStatsReader ()
+    : m_data(0), m_size(0), m_index(0), m_numBlocks(0)
+  {
+  }
+
+  NeoStatsReader::~NeoStatsReader ()
+  {
+    Close();
+  }
+
+  bool
+  NeoStatsReader::Open (const std::string& fileName)
+  {
+    Close();
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (std::size_t)st.st_size < sizeof(NeoStatsFileHeader))
+      {
+	close(fd);
+	return false;
+      }
+
+    void* data = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    m_data = static_cast<const char*>(data);
+    m_size = st.st_size;
+
+    const NeoStatsFileHeader* header = reinterpret_cast<const NeoStatsFileHeader*>(m_data);
+    if (std::memcmp(header->magic, NEO_STATS_MAGIC, sizeof(header->magic)) != 0
+	|| header->version != NEO_STATS_VERSION
+	|| header->byteOrder != NEO_STATS_BYTE_ORDER
+	|| !IsInFile(header->indexOffset, 0)
+	|| header->numBlocks > (m_size - header->indexOffset) / sizeof(NeoStatsBlockIndex))
+      {
+	Close();
+	return false;
+      }
+
+    m_index     = reinterpret_cast<const NeoStatsBlockIndex*>(m_data + header->indexOffset);
+    m_numBlocks = header->numBlocks;
+
+    //A truncated or corrupt file must not send a column past the mapping
+    for (uint64_t i = 0; i < m_numBlocks; ++i)
+      {
+	//Sixteen bytes a flow at least, so the block size cannot overflow
+	if (m_index[i].numFlows > m_size / 16
+	    || !IsInFile(m_index[i].offset, NeoStatsBlockSize(m_index[i].numFlows)))
+	  {
+	    Close();
+	    return false;
+	  }
+      }
+    return true;
+  }
+
+  bool
+  NeoStatsReader::IsInFile (uint64_t offset, uint64_t size) const
+  {
+    //8-byte aligned, after the file header and ending within the file
+    return offset % 8 == 0 && offset >= sizeof(NeoStatsFileHeader)
+      && offset <= m_size && size <= m_size - offset;
+  }
+
+  void
+  NeoStatsReader::Close ()
+  {
+    if (m_data) munmap(const_cast<char*>(m_data), m_size);
+    m_data      = 0;
+    m_size      = 0;
+    m_index     = 0;
+    m_numBlocks = 0;
+  }
+
+  uint64_t
+  NeoStatsReader::GetNBlocks () const
+  {
+    return m_numBlocks;
+  }
+
+  const NeoStatsBlockIndex&
+  NeoStatsReader::GetBlock (uint64_t i) const
+  {
+    return m_index[i];
+  }
+
+  uint64_t
+  NeoStatsReader::FindBlock (uint32_t interval, uint32_t nodeId) const
+  {
+    for (uint64_t i = 0; i < m_numBlocks; ++i)
+      {
+	if (m_index[i].interval == interval && m_index[i].nodeId == nodeId) return i;
+      }
+    return m_numBlocks;
+  }
+
+  /*Columns in block order: pckcnt, bytecnt, srcip, dstip, srcport, dstport, prot
+   */
+  const char*
+  NeoStatsReader::Column (uint64_t i, uint32_t column) const
+  {
+    static const uint32_t width[7] = {8, 8, 4, 4, 2, 2, 1};
+
+    uint64_t n      = m_index[i].numFlows;
+    uint64_t offset = m_index[i].offset;
+    for (uint32_t c = 0; c < column; ++c)
+      {
+	offset += NeoStatsAlign(width[c] * n);
+      }
+    return m_data + offset;
+  }
+
+  const uint64_t* NeoStatsReader::GetPckCnt   (uint64_t i) const { return reinterpret_cast<const uint64_t*>(Column(i, 0)); }
+  const uint64_t* NeoStatsReader::GetByteCnt  (uint64_t i) const { return reinterpret_cast<const uint64_t*>(Column(i, 1)); }
+  const uint32_t* NeoStatsReader::GetSrcIp    (uint64_t i) const { return reinterpret_cast<const uint32_t*>(Column(i, 2)); }
+  const uint32_t* NeoStatsReader::GetDstIp    (uint64_t i) const { return reinterpret_cast<const uint32_t*>(Column(i, 3)); }
+  const uint16_t* NeoStatsReader::GetSrcPort  (uint64_t i) const { return reinterpret_cast<const uint16_t*>(Column(i, 4)); }
+  const uint16_t* NeoStatsReader::GetDstPort  (uint64_t i) const { return reinterpret_cast<const uint16_t*>(Column(i, 5)); }
+  const uint8_t*  NeoStatsReader::GetProtocol (uint64_t i) const { return reinterpret_cast<const uint8_t*>(Column(i, 6)); }
+
+  /*The protocol names of FlowField's operator<<, numbers for the others
+   */
+  static std::string
+  ProtocolName (uint8_t prot)
+  {
+    if (prot == 17) return "UDP";
+    if (prot == 6)  return "TCP";
+    if (prot == 1)  return "ICMP";
+    std::ostringstream os;
+    os << (uint32_t)prot;
+    return os.str();
+  }
+
+  void
+  NeoStatsReader::WriteText (std::ostream& os) const
+  {
+    for (uint64_t i = 0; i < m_numBlocks; ++i)
+      {
+	const NeoStatsBlockIndex& block = m_index[i];
+	os << "Interval " << block.interval << " Node " << block.nodeId
+	   << " TotalFlowCnt " << block.numFlows << std::endl;
+
+	const uint64_t* pckcnt  = GetPckCnt(i);
+	const uint64_t* bytecnt = GetByteCnt(i);
+	const uint32_t* srcip   = GetSrcIp(i);
+	const uint32_t* dstip   = GetDstIp(i);
+	const uint16_t* srcport = GetSrcPort(i);
+	const uint16_t* dstport = GetDstPort(i);
+	const uint8_t*  prot    = GetProtocol(i);
+	for (uint64_t f = 0; f < block.numFlows; ++f)
+	  {
+	    os << (srcip[f] >> 24) << "." << ((srcip[f] >> 16) & 0xff) << "."
+	       << ((srcip[f] >> 8) & 0xff) << "." << (srcip[f] & 0xff) << " "
+	       << (dstip[f] >> 24) << "." << ((dstip[f] >> 16) & 0xff) << "."
+	       << ((dstip[f] >> 8) & 0xff) << "." << (dstip[f] & 0xff) << " "
+	       << ProtocolName(prot[f]) << " " << srcport[f] << " " << dstport[f]
+	       << " PckCnt " << pckcnt[f] << " ByteCnt " << bytecnt[f] << std::endl;
+	  }
+      }
+  }
+
+}
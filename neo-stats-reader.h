@@ -0,0 +1,59 @@
+#ifndef NEO_STATS_READER_H
+#define NEO_STATS_READER_H
+
+#include "neo-stats-format.h"
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+namespace ns3
+{
+
+  ///Read-only view of a binary flow stats file written by NeoStatsWriter.
+  ///The file is mmapped, columns are returned as pointers into the mapping.
+  ///Does not depend on the simulator, so analysis tools can link it alone,
+  ///e.g. the text converter examples/neo-stats-convert.cc.
+  class NeoStatsReader
+  {
+  public:
+    NeoStatsReader ();
+    ~NeoStatsReader ();
+
+    ///False if the file is not a flow stats file, or an index entry points
+    ///outside of it
+    bool Open (const std::string& fileName);
+    void Close ();
+
+    uint64_t                  GetNBlocks () const;
+    const NeoStatsBlockIndex& GetBlock (uint64_t i) const;
+    ///Index of the block of (interval, nodeId), GetNBlocks() if none
+    uint64_t                  FindBlock (uint32_t interval, uint32_t nodeId) const;
+
+    const uint64_t* GetPckCnt   (uint64_t i) const;
+    const uint64_t* GetByteCnt  (uint64_t i) const;
+    const uint32_t* GetSrcIp    (uint64_t i) const;
+    const uint32_t* GetDstIp    (uint64_t i) const;
+    const uint16_t* GetSrcPort  (uint64_t i) const;
+    const uint16_t* GetDstPort  (uint64_t i) const;
+    const uint8_t*  GetProtocol (uint64_t i) const;
+
+    ///Convert to the text format of NeoStatsWriter, line for line
+    void WriteText (std::ostream& os) const;
+
+  private:
+    NeoStatsReader (const NeoStatsReader& rhs);
+    NeoStatsReader& operator= (const NeoStatsReader& rhs);
+
+    bool        IsInFile (uint64_t offset, uint64_t size) const;
+    const char* Column (uint64_t i, uint32_t column) const;
+
+    const char*               m_data;
+    std::size_t               m_size;
+    const NeoStatsBlockIndex* m_index;
+    uint64_t                  m_numBlocks;
+  };
+
+}
+
+#endif
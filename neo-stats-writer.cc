@@ -0,0 +1,203 @@
+#include "neo-stats-writer.h"
+
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("NeoStatsWriter");
+  NS_OBJECT_ENSURE_REGISTERED(NeoStatsWriter);
+
+  TypeId
+  NeoStatsWriter::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::NeoStatsWriter")
+      .SetParent<Object> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<NeoStatsWriter> ()
+      .AddAttribute("FileName",
+		    "The file all flow stats of the run are written to",
+		    StringValue("neo-flow-stats.bin"),
+		    MakeStringAccessor(&NeoStatsWriter::m_fileName),
+		    MakeStringChecker())
+      .AddAttribute("Format",
+		    "Binary columnar blocks or text lines",
+		    EnumValue(NeoStatsWriter::BINARY),
+		    MakeEnumAccessor(&NeoStatsWriter::m_format),
+		    MakeEnumChecker(NeoStatsWriter::BINARY, "Binary",
+				    NeoStatsWriter::TEXT,   "Text"))
+      .AddAttribute("BufferSize",
+		    "The num of bytes buffered before a write to the file",
+		    UintegerValue(1 << 20),
+		    MakeUintegerAccessor(&NeoStatsWriter::m_bufferSize),
+		    MakeUintegerChecker<uint32_t>(4096));
+
+    return tid;
+  }
+
+  NeoStatsWriter::NeoStatsWriter ()
+    : m_offset(0)
+  {
+  }
+
+  NeoStatsWriter::~NeoStatsWriter ()
+  {
+  }
+
+  void
+  NeoStatsWriter::DoDispose (void)
+  {
+    Close();
+    Object::DoDispose();
+  }
+
+  void
+  NeoStatsWriter::Open ()
+  {
+    NS_LOG_DEBUG("Open " << m_fileName);
+    m_file.open(m_fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    NS_ASSERT_MSG(m_file, "Cannot open " << m_fileName);
+
+    m_buffer.reserve(m_bufferSize);
+    m_offset = 0;
+    m_index.clear();
+
+    if (m_format == BINARY)
+      {
+	//Patched with the block count and index offset on Close
+	NeoStatsFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	Append(&header, sizeof(header));
+      }
+  }
+
+  void
+  NeoStatsWriter::WriteBlock (uint32_t interval, uint32_t nodeId, const FlowStatContainer& stats)
+  {
+    if (!m_file.is_open()) Open();
+
+    if (m_format == TEXT)
+      {
+	std::ostringstream os;
+	os << "Interval " << interval << " Node " << nodeId << " TotalFlowCnt " << stats.size() << std::endl;
+	for (FlowStatContainerCI ci = stats.cbegin(); ci != stats.cend(); ++ci)
+	  {
+	    os << ci->first << " " << ci->second << std::endl;
+	  }
+	std::string lines = os.str();
+	Append(lines.data(), lines.size());
+	return;
+      }
+
+    NeoStatsBlockIndex block;
+    block.interval = interval;
+    block.nodeId   = nodeId;
+    block.offset   = m_offset;
+    block.numFlows = stats.size();
+    m_index.push_back(block);
+
+    m_pckcnt.clear(); m_bytecnt.clear();
+    m_srcip.clear();  m_dstip.clear();
+    m_srcport.clear(); m_dstport.clear();
+    m_prot.clear();
+    for (FlowStatContainerCI ci = stats.cbegin(); ci != stats.cend(); ++ci)
+      {
+	m_pckcnt.push_back(ci->second.pckcnt);
+	m_bytecnt.push_back(ci->second.bytecnt);
+	m_srcip.push_back(ci->first.ipv4srcip);
+	m_dstip.push_back(ci->first.ipv4dstip);
+	m_srcport.push_back(ci->first.srcport);
+	m_dstport.push_back(ci->first.dstport);
+	m_prot.push_back(ci->first.ipv4prot);
+      }
+
+    uint64_t n = block.numFlows;
+    if (n == 0) return;
+    Append(&m_pckcnt[0],  8 * n); Pad();
+    Append(&m_bytecnt[0], 8 * n); Pad();
+    Append(&m_srcip[0],   4 * n); Pad();
+    Append(&m_dstip[0],   4 * n); Pad();
+    Append(&m_srcport[0], 2 * n); Pad();
+    Append(&m_dstport[0], 2 * n); Pad();
+    Append(&m_prot[0],    1 * n); Pad();
+    NS_ASSERT(m_offset == block.offset + NeoStatsBlockSize(n));
+  }
+
+  void
+  NeoStatsWriter::AddProbe (Ptr<NeoProbe> probe)
+  {
+    probe->TraceConnectWithoutContext("EpochEnd", MakeCallback(&NeoStatsWriter::NotifyEpochEnd, this));
+  }
+
+  void
+  NeoStatsWriter::NotifyEpochEnd (Ptr<const NeoProbe> probe, uint32_t epoch)
+  {
+    WriteBlock(epoch, probe->GetNodeId(), probe->GetEpochFlowStats());
+  }
+
+  void
+  NeoStatsWriter::Close ()
+  {
+    if (!m_file.is_open()) return;
+
+    if (m_format == BINARY)
+      {
+	NeoStatsFileHeader header;
+	std::memcpy(header.magic, NEO_STATS_MAGIC, sizeof(header.magic));
+	header.version     = NEO_STATS_VERSION;
+	header.byteOrder   = NEO_STATS_BYTE_ORDER;
+	header.numBlocks   = m_index.size();
+	header.indexOffset = m_offset;
+	if (!m_index.empty()) Append(&m_index[0], m_index.size() * sizeof(NeoStatsBlockIndex));
+	Flush();
+
+	m_file.seekp(0);
+	m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      }
+    else
+      {
+	Flush();
+      }
+
+    NS_LOG_DEBUG("Close " << m_fileName << " blocks " << m_index.size() << " bytes " << m_offset);
+    m_file.close();
+  }
+
+  void
+  NeoStatsWriter::Append (const void* data, uint64_t size)
+  {
+    const char* bytes = static_cast<const char*>(data);
+    m_offset += size;
+    while (size > 0)
+      {
+	uint64_t room = m_bufferSize - m_buffer.size();
+	uint64_t part = size < room ? size : room;
+	m_buffer.insert(m_buffer.end(), bytes, bytes + part);
+	bytes += part;
+	size  -= part;
+	if (m_buffer.size() == m_bufferSize) Flush();
+      }
+  }
+
+  void
+  NeoStatsWriter::Pad ()
+  {
+    static const char zeros[8] = {0};
+    Append(zeros, NeoStatsAlign(m_offset) - m_offset);
+  }
+
+  void
+  NeoStatsWriter::Flush ()
+  {
+    if (m_buffer.empty()) return;
+    m_file.write(&m_buffer[0], m_buffer.size());
+    m_buffer.clear();
+  }
+
+}
@@ -0,0 +1,68 @@
+#ifndef NEO_STATS_WRITER_H
+#define NEO_STATS_WRITER_H
+
+#include "neo-probe.h"
+#include "neo-stats-format.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+  ///Writes the flow stats of all switches and intervals of a run to one file.
+  ///Binary is the columnar format of neo-stats-format.h, written through a
+  ///buffer; Text keeps the PrintRealFlowStats lines under a block header.
+  class NeoStatsWriter : public Object
+  {
+  public:
+    enum Format
+    {
+      BINARY,
+      TEXT
+    };
+
+    static TypeId GetTypeId (void);
+
+    NeoStatsWriter ();
+    virtual ~NeoStatsWriter ();
+
+    void WriteBlock (uint32_t interval, uint32_t nodeId, const FlowStatContainer& stats);
+    void Close ();
+
+    ///Write the probe's frozen real flow stats at the end of every epoch
+    void AddProbe (Ptr<NeoProbe> probe);
+
+  protected:
+    virtual void DoDispose (void);
+
+  private:
+    void NotifyEpochEnd (Ptr<const NeoProbe> probe, uint32_t epoch);
+    void Open ();
+    void Append (const void* data, uint64_t size);
+    void Pad ();
+    void Flush ();
+
+    std::string m_fileName;   //Attribute
+    Format      m_format;     //Attribute
+    uint32_t    m_bufferSize; //Attribute
+
+    std::ofstream                   m_file;
+    std::vector<char>               m_buffer;
+    uint64_t                        m_offset;
+    std::vector<NeoStatsBlockIndex> m_index;
+
+    //Column staging, reused across blocks
+    std::vector<uint64_t> m_pckcnt;
+    std::vector<uint64_t> m_bytecnt;
+    std::vector<uint32_t> m_srcip;
+    std::vector<uint32_t> m_dstip;
+    std::vector<uint16_t> m_srcport;
+    std::vector<uint16_t> m_dstport;
+    std::vector<uint8_t>  m_prot;
+  };
+
+}
+
+#endif
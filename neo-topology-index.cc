@@ -0,0 +1,97 @@
+#include "neo-topology-index.h"
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/ipv4.h"
+
+#include <algorithm>
+
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("NeoTopologyIndex");
+
+  NeoTopologyIndex::NeoTopologyIndex (const std::vector<NodeContainer>& podHostNodes, int16_t numAddrPerHost)
+    : m_numPod(podHostNodes.size()),
+      m_numHostPerPod(podHostNodes.empty() ? 0 : podHostNodes[0].GetN()),
+      m_numAddrPerHost(numAddrPerHost)
+  {
+    NS_ASSERT_MSG(m_numPod > 0 && m_numHostPerPod > 0 && m_numAddrPerHost > 0, "No hosts to index");
+
+    uint32_t numHosts = m_numPod * m_numHostPerPod;
+    m_hosts.reserve(numHosts);
+    m_addrs.reserve(numHosts * m_numAddrPerHost);
+    m_local.reserve(numHosts);
+    m_addrHosts.reserve(numHosts * m_numAddrPerHost);
+
+    for (int16_t iPod = 0; iPod < m_numPod; ++iPod)
+      {
+	NS_ASSERT_MSG(podHostNodes[iPod].GetN() == (uint32_t)m_numHostPerPod, "Pods differ in size");
+	for (NodeContainer::Iterator it = podHostNodes[iPod].Begin(); it != podHostNodes[iPod].End(); ++it)
+	  {
+	    Ptr<Ipv4> ipv4 = (*it)->GetObject<Ipv4>();
+	    NS_ASSERT_MSG(ipv4 && ipv4->GetNInterfaces() > 1 && ipv4->GetNAddresses(1) >= (uint32_t)m_numAddrPerHost,
+			  "Host " << (*it)->GetId() << " lacks its addresses");
+
+	    int32_t iHost = m_hosts.size();
+	    for (int16_t i = 0; i < m_numAddrPerHost; ++i)
+	      {
+		Ipv4Address addr = ipv4->GetAddress(1, i).GetLocal();
+		m_addrs.push_back(addr);
+		m_addrHosts.push_back(AddrHost(addr.Get(), iHost));
+	      }
+
+	    bool local = true;
+#ifdef NS3_MPI
+	    if (MpiInterface::IsEnabled()) local = (*it)->GetSystemId() == MpiInterface::GetSystemId();
+#endif
+	    m_hosts.push_back(*it);
+	    m_local.push_back(local);
+	  }
+      }
+    std::sort(m_addrHosts.begin(), m_addrHosts.end());
+
+    NS_LOG_DEBUG("Hosts " << numHosts << " addresses " << m_addrs.size() << " bytes " << GetMemoryBytes());
+  }
+
+  int32_t
+  NeoTopologyIndex::FindHost (uint32_t addr) const
+  {
+    std::vector<AddrHost>::const_iterator it =
+      std::lower_bound(m_addrHosts.begin(), m_addrHosts.end(), AddrHost(addr, -1));
+    return (it != m_addrHosts.end() && it->first == addr) ? it->second : -1;
+  }
+
+  uint64_t
+  NeoTopologyIndex::GetMemoryBytes () const
+  {
+    return m_hosts.capacity() * sizeof(Ptr<Node>)
+      + m_addrs.capacity() * sizeof(Ipv4Address)
+      + m_local.capacity() / 8
+      + m_addrHosts.capacity() * sizeof(AddrHost);
+  }
+
+  bool
+  IsDistributed ()
+  {
+#ifdef NS3_MPI
+    return MpiInterface::IsEnabled();
+#else
+    return false;
+#endif
+  }
+
+  bool
+  IsFirstSystem ()
+  {
+#ifdef NS3_MPI
+    if (MpiInterface::IsEnabled()) return MpiInterface::GetSystemId() == 0;
+#endif
+    return true;
+  }
+
+}
@@ -0,0 +1,69 @@
+#ifndef NEO_TOPOLOGY_INDEX_H
+#define NEO_TOPOLOGY_INDEX_H
+
+#include <utility>
+#include <vector>
+
+#include "ns3/simple-ref-count.h"
+#include "ns3/ptr.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/ipv4-address.h"
+
+namespace ns3
+{
+
+  /*Immutable index of the hosts of a network, built once the addresses are
+   *assigned and shared by the network and the flow generator. Hosts are
+   *numbered pod * NumOfHostPerPod + host; their nodes, addresses and rank
+   *are kept in flat arrays, so flow setup needs no NodeContainer copies nor
+   *Ipv4 aggregate lookups. The const accessors touch no reference counts and
+   *may be called from any thread.
+   */
+  ///Running under MPI, always false without it
+  bool IsDistributed ();
+  ///The MPI rank 0, or the only one
+  bool IsFirstSystem ();
+
+  class NeoTopologyIndex : public SimpleRefCount<NeoTopologyIndex>
+  {
+  public:
+    ///The first numAddrPerHost addresses of interface 1 of every host
+    NeoTopologyIndex (const std::vector<NodeContainer>& podHostNodes, int16_t numAddrPerHost);
+
+    int16_t GetNumPod () const         { return m_numPod; }
+    int16_t GetNumHostPerPod () const  { return m_numHostPerPod; }
+    int16_t GetNumAddrPerHost () const { return m_numAddrPerHost; }
+    int32_t GetNumHosts () const       { return m_hosts.size(); }
+
+    int32_t GetHostIndex (int16_t iPod, int16_t iHst) const { return iPod * m_numHostPerPod + iHst; }
+
+    const Ptr<Node>&   GetHost (int32_t iHost) const { return m_hosts[iHost]; }
+    const Ipv4Address& GetAddress (int32_t iHost, uint32_t addrIdx) const
+    {
+      return m_addrs[iHost * m_numAddrPerHost + addrIdx];
+    }
+    ///Simulated by this MPI rank, always true without MPI
+    bool IsLocal (int32_t iHost) const { return m_local[iHost]; }
+
+    ///Host index of an address, -1 if no host has it
+    int32_t FindHost (uint32_t addr) const;
+
+    ///Bytes held by the index
+    uint64_t GetMemoryBytes () const;
+
+  private:
+    typedef std::pair<uint32_t, int32_t> AddrHost; //(address, host index)
+
+    int16_t                  m_numPod;
+    int16_t                  m_numHostPerPod;
+    int16_t                  m_numAddrPerHost;
+    std::vector<Ptr<Node> >  m_hosts;     //by host index
+    std::vector<Ipv4Address> m_addrs;     //NumOfAddrPerHost per host
+    std::vector<bool>        m_local;     //by host index
+    std::vector<AddrHost>    m_addrHosts; //sorted by address
+  };
+
+}
+
+#endif
@@ -0,0 +1,387 @@
+#include "sampled-flow-probe.h"
+#include "neo-stats-writer.h"
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+#include "ns3/random-variable-stream.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("SampledFlowProbe");
+  NS_OBJECT_ENSURE_REGISTERED(SampledFlowProbe);
+
+  TypeId
+  SampledFlowProbe::GetTypeId (void)
+  {
+    static TypeId tid = TypeId("ns3::SampledFlowProbe")
+      .SetParent<NeoProbe> ()
+      .SetGroupName ("NeoFlowMonitor")
+      .AddConstructor<SampledFlowProbe> ()
+      .AddAttribute("SamplingRate",
+		    "N of 1 in N packet sampling, 1 to see every packet",
+		    UintegerValue(100),
+		    MakeUintegerAccessor(&SampledFlowProbe::m_samplingRate),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("CacheSize",
+		    "The num of flow records the cache holds",
+		    UintegerValue(1024),
+		    MakeUintegerAccessor(&SampledFlowProbe::m_cacheSize),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("InactiveTimeout",
+		    "A record is exported once its flow had no sampled packet for this long, zero for never",
+		    TimeValue(MilliSeconds(15)),
+		    MakeTimeAccessor(&SampledFlowProbe::m_inactiveTimeout),
+		    MakeTimeChecker())
+      .AddAttribute("ActiveTimeout",
+		    "A record is exported once it is this old, zero to keep it to the end of the epoch",
+		    TimeValue(Seconds(0)),
+		    MakeTimeAccessor(&SampledFlowProbe::m_activeTimeout),
+		    MakeTimeChecker())
+      .AddAttribute("ExportRecordBytes",
+		    "The bytes of an exported flow record, 48 for NetFlow v5",
+		    UintegerValue(48),
+		    MakeUintegerAccessor(&SampledFlowProbe::m_recordBytes),
+		    MakeUintegerChecker<uint32_t>(1))
+      .AddAttribute("ExportHeaderBytes",
+		    "The header bytes of an export packet, the NetFlow v5 header with UDP and IPv4",
+		    UintegerValue(24 + 8 + 20),
+		    MakeUintegerAccessor(&SampledFlowProbe::m_headerBytes),
+		    MakeUintegerChecker<uint32_t>())
+      .AddAttribute("RecordsPerExportPacket",
+		    "The num of records sent to the collector in one export packet",
+		    UintegerValue(30),
+		    MakeUintegerAccessor(&SampledFlowProbe::m_recordsPerPacket),
+		    MakeUintegerChecker<uint32_t>(1));
+
+    return tid;
+  }
+
+  SampledFlowProbe::SampledFlowProbe ()
+    : m_skip(0), m_free(NIL), m_lruHead(NIL), m_lruTail(NIL)
+  {
+  }
+
+  SampledFlowProbe::~SampledFlowProbe ()
+  {
+  }
+
+  void
+  SampledFlowProbe::NotifyConstructionCompleted (void)
+  {
+    NeoProbe::NotifyConstructionCompleted ();
+
+    //Attributes are only known here, allocate the fixed memory once.
+    m_entries.assign (m_cacheSize, SampledFlowEntry());
+    for (uint32_t i = 0; i < m_cacheSize; ++i) m_entries[i].chain = i + 1 < m_cacheSize ? i + 1 : NIL;
+    m_free = 0;
+    m_buckets.assign (m_cacheSize, NIL);
+    m_exportBuffer.reserve (m_recordsPerPacket);
+
+    m_uniform = CreateObject<UniformRandomVariable> ();
+    m_skip    = DrawSkip ();
+    m_stats   = EpochStats();
+
+    NS_LOG_DEBUG("Sampling 1/" << m_samplingRate << " cache " << m_cacheSize
+		 << " inactive " << m_inactiveTimeout.GetMilliSeconds() << "ms"
+		 << " active " << m_activeTimeout.GetMilliSeconds() << "ms");
+  }
+
+  void
+  SampledFlowProbe::DoDispose (void)
+  {
+    m_uniform = 0;
+    NeoProbe::DoDispose ();
+  }
+
+  int64_t
+  SampledFlowProbe::AssignStreams (int64_t stream)
+  {
+    m_uniform->SetStream (stream);
+    m_skip = DrawSkip ();
+    return 1;
+  }
+
+  uint32_t
+  SampledFlowProbe::DrawSkip ()
+  {
+    //Random 1 in N sampling draws the gap to the next sample, not a number per packet
+    if (m_samplingRate == 1) return 0;
+    double u    = 1. - m_uniform->GetValue ();
+    double skip = std::floor (std::log (u) / std::log (1. - 1. / m_samplingRate));
+    return skip < 4e9 ? (uint32_t)skip : 4000000000u;
+  }
+
+  void
+  SampledFlowProbe::ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash)
+  {
+    //1. Update real flow stats;
+    UpdateRealFlowStats (flow, hash, ipHeader.GetPayloadSize());
+
+    //2. Sample;
+    ++m_stats.packets;
+    if (m_skip > 0)
+      {
+	--m_skip;
+	return;
+      }
+    m_skip = DrawSkip ();
+    Sample (flow, hash, ipHeader.GetPayloadSize());
+  }
+
+  uint32_t
+  SampledFlowProbe::Find (const FlowField& flow, uint64_t hash) const
+  {
+    uint32_t iE = m_buckets[FlowHashIndex (hash, 0, m_buckets.size())];
+    while (iE != NIL && !(m_entries[iE].hash == hash && m_entries[iE].flow == flow)) iE = m_entries[iE].chain;
+    return iE;
+  }
+
+  void
+  SampledFlowProbe::Sample (const FlowField& flow, uint64_t hash, uint32_t byteCnt)
+  {
+    int64_t now = Simulator::Now ().GetNanoSeconds ();
+    ++m_stats.sampledPackets;
+
+    //Idle flows sit at the LRU end
+    if (!m_inactiveTimeout.IsZero ())
+      {
+	int64_t inactiveNs = m_inactiveTimeout.GetNanoSeconds ();
+	while (m_lruTail != NIL && now - m_entries[m_lruTail].lastNs >= inactiveNs)
+	  {
+	    ++m_stats.timeouts;
+	    Expire (m_lruTail);
+	  }
+      }
+
+    uint32_t iE = Find (flow, hash);
+    if (iE != NIL && !m_activeTimeout.IsZero () && now - m_entries[iE].firstNs >= m_activeTimeout.GetNanoSeconds ())
+      {
+	++m_stats.timeouts;
+	Expire (iE);
+	iE = NIL;
+      }
+
+    if (iE == NIL)
+      {
+	if (m_free == NIL)
+	  {
+	    ++m_stats.lruEvictions;
+	    Expire (m_lruTail);
+	  }
+	iE     = m_free;
+	m_free = m_entries[iE].chain;
+
+	SampledFlowEntry& entry = m_entries[iE];
+	uint32_t&         head  = m_buckets[FlowHashIndex (hash, 0, m_buckets.size())];
+	entry.flow    = flow;
+	entry.hash    = hash;
+	entry.stat    = PckByteField();
+	entry.firstNs = now;
+	entry.chain   = head;
+	head          = iE;
+      }
+    else
+      {
+	LruUnlink (iE);
+      }
+
+    m_entries[iE].lastNs = now;
+    m_entries[iE].stat.Add (byteCnt);
+    LruPushFront (iE);
+  }
+
+  void
+  SampledFlowProbe::Expire (uint32_t iE)
+  {
+    SampledFlowEntry& entry = m_entries[iE];
+
+    uint32_t* link = &m_buckets[FlowHashIndex (entry.hash, 0, m_buckets.size())];
+    while (*link != iE) link = &m_entries[*link].chain;
+    *link = entry.chain;
+    LruUnlink (iE);
+
+    m_exportBuffer.push_back (entry);
+    ++m_stats.exportRecords;
+    if (m_exportBuffer.size() >= m_recordsPerPacket) FlushExportBuffer ();
+
+    entry.chain = m_free;
+    m_free      = iE;
+  }
+
+  void
+  SampledFlowProbe::LruPushFront (uint32_t iE)
+  {
+    m_entries[iE].lruPrev = NIL;
+    m_entries[iE].lruNext = m_lruHead;
+    if (m_lruHead != NIL) m_entries[m_lruHead].lruPrev = iE;
+    else                  m_lruTail = iE;
+    m_lruHead = iE;
+  }
+
+  void
+  SampledFlowProbe::LruUnlink (uint32_t iE)
+  {
+    SampledFlowEntry& entry = m_entries[iE];
+    if (entry.lruPrev != NIL) m_entries[entry.lruPrev].lruNext = entry.lruNext;
+    else                      m_lruHead = entry.lruNext;
+    if (entry.lruNext != NIL) m_entries[entry.lruNext].lruPrev = entry.lruPrev;
+    else                      m_lruTail = entry.lruPrev;
+  }
+
+  void
+  SampledFlowProbe::FlushExportBuffer ()
+  {
+    if (m_exportBuffer.empty()) return;
+
+    ++m_stats.exportPackets;
+    m_stats.exportBytes += m_headerBytes + (uint64_t)m_exportBuffer.size() * m_recordBytes;
+
+    for (uint32_t i = 0; i < m_exportBuffer.size(); ++i) AddEstimate (m_estimates, m_exportBuffer[i]);
+    m_exportBuffer.clear();
+  }
+
+  void
+  SampledFlowProbe::AddEstimate (FlowStatContainer& estimates, const SampledFlowEntry& record) const
+  {
+    //The collector adds up the records of a flow, scaled by the sampling rate
+    PckByteField& estimate = estimates.FindOrInsert (record.flow, record.hash);
+    estimate.pckcnt  = SaturatingAdd<uint64_t> (estimate.pckcnt,  record.stat.pckcnt  * m_samplingRate);
+    estimate.bytecnt = SaturatingAdd<uint64_t> (estimate.bytecnt, record.stat.bytecnt * m_samplingRate);
+  }
+
+  void
+  SampledFlowProbe::DoRollOver ()
+  {
+    //The epoch end exports every record left in the cache
+    while (m_lruTail != NIL) Expire (m_lruTail);
+    FlushExportBuffer ();
+
+    //The real flow stats are frozen already
+    Evaluate (GetEpochFlowStats(), m_estimates, m_stats);
+    m_epochStats.push_back(m_stats);
+    m_epochEstimates.swap (m_estimates);
+    m_estimates.clear ();
+    m_stats = EpochStats();
+  }
+
+  void
+  SampledFlowProbe::Evaluate (const FlowStatContainer& real, const FlowStatContainer& estimates,
+			      EpochStats& stats) const
+  {
+    uint64_t realBytes = 0;
+    double   byteError = 0.;
+    stats.epoch         = GetEpoch();
+    stats.realFlows     = real.size();
+    stats.reportedFlows = 0;
+    stats.avgRelError   = 0.;
+    for (FlowStatContainerCI ci = real.cbegin(); ci != real.cend(); ++ci)
+      {
+	FlowStatContainerCI est   = estimates.find(ci->first);
+	double              bytes = est == estimates.cend() ? 0. : est->second.bytecnt;
+	double              error = std::fabs(bytes - (double)ci->second.bytecnt);
+	if (est != estimates.cend()) ++stats.reportedFlows;
+	stats.avgRelError += ci->second.bytecnt ? error / ci->second.bytecnt : 0.;
+	byteError         += error;
+	realBytes         += ci->second.bytecnt;
+      }
+    if (stats.realFlows) stats.avgRelError /= stats.realFlows;
+    stats.byteRelError = realBytes ? byteError / realBytes : 0.;
+
+    NS_LOG_DEBUG("Node " << GetNodeId() << " epoch " << stats.epoch
+		 << " sampled " << stats.sampledPackets << "/" << stats.packets
+		 << " export bytes " << stats.exportBytes
+		 << " reported " << stats.reportedFlows << "/" << stats.realFlows
+		 << " ARE " << stats.avgRelError);
+  }
+
+  void
+  SampledFlowProbe::EvaluateOpenEpoch (EpochStats& stats) const
+  {
+    //Scored as the rollover would: the pending records and the whole cache
+    //exported, in packets of RecordsPerExportPacket records
+    stats = m_stats;
+    FlowStatContainer estimates (m_estimates);
+    uint64_t pending = m_exportBuffer.size();
+    for (uint32_t i = 0; i < m_exportBuffer.size(); ++i) AddEstimate (estimates, m_exportBuffer[i]);
+    for (uint32_t iE = m_lruHead; iE != NIL; iE = m_entries[iE].lruNext)
+      {
+	AddEstimate (estimates, m_entries[iE]);
+	++stats.exportRecords;
+	++pending;
+      }
+    uint64_t numPackets = (pending + m_recordsPerPacket - 1) / m_recordsPerPacket;
+    stats.exportPackets += numPackets;
+    stats.exportBytes   += numPackets * m_headerBytes + pending * m_recordBytes;
+    Evaluate (GetRealFlowStats(), estimates, stats);
+  }
+
+  const FlowStatContainer&
+  SampledFlowProbe::GetEpochEstimates () const
+  {
+    return m_epochEstimates;
+  }
+
+  void
+  SampledFlowProbe::PrintEstimatedFlowStats (std::string fileNameSuffix) const
+  {
+    PrintFlowStats (fileNameSuffix, m_epochEstimates);
+  }
+
+  void
+  SampledFlowProbe::ExportEstimatedFlowStats (Ptr<NeoStatsWriter> writer, uint32_t interval) const
+  {
+    writer->WriteBlock (interval, GetNodeId(), m_epochEstimates);
+  }
+
+  uint64_t
+  SampledFlowProbe::GetMemoryBytes () const
+  {
+    //A padded 5-tuple, 64-bit packet and byte counters and two 32-bit timestamps
+    //per record, and a 32-bit head per bucket
+    return (uint64_t)m_entries.size() * (sizeof(FlowField) + 8 + 8 + 4 + 4) + m_buckets.size() * 4;
+  }
+
+  void
+  SampledFlowProbe::PrintMeasurementStats (std::string fileNameSuffix) const
+  {
+    std::stringstream ss;       ss << GetNodeId() << "-" << fileNameSuffix;
+    std::string       filename; ss >> filename;
+    std::ofstream     file (filename.c_str());
+    NS_ASSERT(file);
+
+    //The open epoch, partial or the whole run without epochs, is scored here
+    std::vector<EpochStats> epochStats = m_epochStats;
+    if (m_stats.packets > 0)
+      {
+	epochStats.push_back(EpochStats());
+	EvaluateOpenEpoch (epochStats.back());
+      }
+
+    file << "SamplingRate " << m_samplingRate << " CacheSize " << m_cacheSize
+	 << " MemoryBytes " << GetMemoryBytes() << std::endl;
+    for (uint32_t i = 0; i < epochStats.size(); ++i)
+      {
+	const EpochStats& stats = epochStats[i];
+	file << "Interval "        << stats.epoch
+	     << " Packets "        << stats.packets
+	     << " SampledPackets " << stats.sampledPackets
+	     << " ExportRecords "  << stats.exportRecords
+	     << " ExportPackets "  << stats.exportPackets
+	     << " ExportBytes "    << stats.exportBytes
+	     << " LruEvictions "   << stats.lruEvictions
+	     << " Timeouts "       << stats.timeouts
+	     << " RealFlows "      << stats.realFlows
+	     << " ReportedFlows "  << stats.reportedFlows
+	     << " ARE "            << stats.avgRelError
+	     << " ByteRelError "   << stats.byteRelError << std::endl;
+      }
+  }
+
+}
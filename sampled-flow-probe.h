@@ -0,0 +1,122 @@
+#ifndef SAMPLED_FLOW_PROBE_H
+#define SAMPLED_FLOW_PROBE_H
+
+#include "neo-probe.h"
+
+#include <vector>
+
+namespace ns3
+{
+
+  class UniformRandomVariable;
+
+  ///Flow cache entry, in a bucket chain and in the LRU list
+  struct SampledFlowEntry
+  {
+    FlowField    flow;
+    uint64_t     hash;
+    PckByteField stat;     //sampled packets and bytes
+    int64_t      firstNs;
+    int64_t      lastNs;
+    uint32_t     chain;    //next entry of the bucket, or of the free list
+    uint32_t     lruPrev;  //towards the most recently used
+    uint32_t     lruNext;  //towards the least recently used
+  };
+
+  ///NetFlow/sFlow style baseline: 1 in SamplingRate packets, drawn at random,
+  ///updates a flow cache of CacheSize entries. A record leaves the cache into
+  ///the export buffer when its flow is idle for InactiveTimeout, active for
+  ///ActiveTimeout, evicted as least recently used to make room, or at the end
+  ///of the epoch. Every RecordsPerExportPacket records go to the collector as
+  ///one export packet; the collector scales the sampled counts by
+  ///SamplingRate. Per epoch the export volume and the estimates' error
+  ///against the real flow stats are kept, to set its measurement overhead
+  ///against the fixed memory of the encoded flowsets.
+  class SampledFlowProbe : public NeoProbe
+  {
+  public:
+    SampledFlowProbe ();
+    virtual ~SampledFlowProbe ();
+    static TypeId GetTypeId (void);
+
+  public:
+    void ForwardLogger (const Ipv4Header &ipHeader, const FlowField &flow, uint64_t hash);
+    void PrintMeasurementStats (std::string fileNameSuffix) const;
+    uint64_t GetMemoryBytes () const;
+
+    ///The collector's flow estimates of the last epoch
+    const FlowStatContainer& GetEpochEstimates () const;
+    ///Same lines and writer as the real flow stats
+    void PrintEstimatedFlowStats (std::string fileNameSuffix) const;
+    void ExportEstimatedFlowStats (Ptr<NeoStatsWriter> writer, uint32_t interval) const;
+
+    ///Fix the sampling random stream; returns streams used
+    virtual int64_t AssignStreams (int64_t stream);
+
+  protected:
+    virtual void NotifyConstructionCompleted (void);
+    virtual void DoDispose (void);
+    virtual void DoRollOver ();
+
+  private:
+    ///Per epoch export volume and accuracy
+    struct EpochStats
+    {
+      uint32_t epoch;
+      uint64_t packets;
+      uint64_t sampledPackets;
+      uint64_t exportRecords;
+      uint64_t exportPackets;
+      uint64_t exportBytes;     //sent to the collector, headers included
+      uint64_t lruEvictions;    //records pushed out by a full cache
+      uint64_t timeouts;        //records of inactive or long active flows
+      uint64_t realFlows;
+      uint64_t reportedFlows;   //real flows the collector has an estimate of
+      double   avgRelError;     //bytes, over the real flows, 1 for a missed flow
+      double   byteRelError;    //sum of byte errors over the real bytes
+    };
+
+    static const uint32_t NIL = 0xffffffff;
+
+    void     Sample (const FlowField& flow, uint64_t hash, uint32_t byteCnt);
+    ///Packets to skip before the next sampled one, geometric
+    uint32_t DrawSkip ();
+    uint32_t Find (const FlowField& flow, uint64_t hash) const;
+    ///Unlink an entry from its bucket and the LRU list, send it to the export buffer
+    void     Expire (uint32_t iE);
+    void     LruPushFront (uint32_t iE);
+    void     LruUnlink (uint32_t iE);
+    void     FlushExportBuffer ();
+    void     AddEstimate (FlowStatContainer& estimates, const SampledFlowEntry& record) const;
+    ///Estimate errors against real, export counters are the caller's
+    void     Evaluate (const FlowStatContainer& real, const FlowStatContainer& estimates, EpochStats& stats) const;
+    void     EvaluateOpenEpoch (EpochStats& stats) const;
+
+    uint32_t m_samplingRate;     //Attribute
+    uint32_t m_cacheSize;        //Attribute
+    Time     m_inactiveTimeout;  //Attribute
+    Time     m_activeTimeout;    //Attribute
+    uint32_t m_recordBytes;      //Attribute
+    uint32_t m_headerBytes;      //Attribute
+    uint32_t m_recordsPerPacket; //Attribute
+
+    Ptr<UniformRandomVariable>    m_uniform;
+    uint32_t                      m_skip;
+
+    std::vector<SampledFlowEntry> m_entries;
+    std::vector<uint32_t>         m_buckets;  //head entry of each chain
+    uint32_t                      m_free;     //free list head
+    uint32_t                      m_lruHead;  //most recently used
+    uint32_t                      m_lruTail;  //least recently used
+
+    std::vector<SampledFlowEntry> m_exportBuffer;
+    FlowStatContainer             m_estimates;      //collector, current epoch
+    FlowStatContainer             m_epochEstimates; //collector, last epoch
+
+    EpochStats                    m_stats;          //current epoch
+    std::vector<EpochStats>       m_epochStats;
+  };
+
+}
+
+#endif
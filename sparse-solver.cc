@@ -0,0 +1,70 @@
+#include "sparse-solver.h"
+
+#include <cmath>
+
+namespace ns3
+{
+
+  void
+  CsrMatrix::Multiply (const std::vector<double>& x, std::vector<double>& y) const
+  {
+    y.assign (numRows, 0.);
+    for (uint32_t i = 0; i < numRows; ++i)
+      {
+	double sum = 0.;
+	for (uint32_t j = rowPtr[i]; j < rowPtr[i + 1]; ++j) sum += values[j] * x[colIdx[j]];
+	y[i] = sum;
+      }
+  }
+
+  void
+  CsrMatrix::MultiplyTransposed (const std::vector<double>& x, std::vector<double>& y) const
+  {
+    y.assign (numCols, 0.);
+    for (uint32_t i = 0; i < numRows; ++i)
+      {
+	for (uint32_t j = rowPtr[i]; j < rowPtr[i + 1]; ++j) y[colIdx[j]] += values[j] * x[i];
+      }
+  }
+
+  static double
+  Dot (const std::vector<double>& u, const std::vector<double>& v)
+  {
+    double sum = 0.;
+    for (uint32_t i = 0; i < u.size(); ++i) sum += u[i] * v[i];
+    return sum;
+  }
+
+  uint32_t
+  CglsSolve (const CsrMatrix& a, const std::vector<double>& b, std::vector<double>& x,
+	     uint32_t maxIter, double tol)
+  {
+    x.assign (a.numCols, 0.);
+    std::vector<double> r (b), s, p, q;
+    a.MultiplyTransposed (r, s);
+    p = s;
+
+    double gamma  = Dot (s, s);
+    double gamma0 = gamma;
+    uint32_t iter = 0;
+    while (iter < maxIter && gamma > tol * tol * gamma0 && gamma > 0.)
+      {
+	a.Multiply (p, q);
+	double qq = Dot (q, q);
+	if (qq == 0.) break;
+
+	double alpha = gamma / qq;
+	for (uint32_t i = 0; i < x.size(); ++i) x[i] += alpha * p[i];
+	for (uint32_t i = 0; i < r.size(); ++i) r[i] -= alpha * q[i];
+
+	a.MultiplyTransposed (r, s);
+	double gammaNew = Dot (s, s);
+	double beta     = gammaNew / gamma;
+	for (uint32_t i = 0; i < p.size(); ++i) p[i] = s[i] + beta * p[i];
+	gamma = gammaNew;
+	++iter;
+      }
+    return iter;
+  }
+
+}
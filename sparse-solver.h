@@ -0,0 +1,39 @@
+#ifndef SPARSE_SOLVER_H
+#define SPARSE_SOLVER_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+
+  ///Compressed sparse row matrix
+  struct CsrMatrix
+  {
+    uint32_t              numRows;
+    uint32_t              numCols;
+    std::vector<uint32_t> rowPtr;  //numRows + 1, row i is [rowPtr[i], rowPtr[i + 1])
+    std::vector<uint32_t> colIdx;
+    std::vector<double>   values;
+
+    CsrMatrix ()
+      : numRows(0), numCols(0)
+    {
+    }
+
+    ///y = A x
+    void Multiply (const std::vector<double>& x, std::vector<double>& y) const;
+    ///y = A^T x
+    void MultiplyTransposed (const std::vector<double>& x, std::vector<double>& y) const;
+  };
+
+  ///Least squares solution of A x = b by conjugate gradients on the normal
+  ///equations (CGLS), starting from x = 0. Stops after maxIter iterations or
+  ///once |A^T (b - A x)| falls below tol times its start value; returns the
+  ///iterations run.
+  uint32_t CglsSolve (const CsrMatrix& a, const std::vector<double>& b, std::vector<double>& x,
+		      uint32_t maxIter, double tol);
+
+}
+
+#endif